@@ -1,17 +1,49 @@
 // JSON/XML Simple Library (JXSL). Contains main functions to operate with JSON/XML files. Created by Oleksandr Shchur.
 
 #include "jxsl_lib.h"
+#include <ctype.h>
+#include <errno.h>
+#include <limits.h>
+#include <stddef.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef _WIN32
 #include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include <unistd.h>
-#include <string.h>
+#endif
 
-// a struct to optimize XML file editing with Indexing
+// a struct to optimize XML file editing with Indexing: one slot of the on-disk hash index kept next to an XML file
+// in "<file>.idx" (header, then a power-of-two number of slots probed linearly)
 typedef struct {
     char key[256];
-    long position;
+    long position; // offset of the value in the XML file, -1 for an empty slot
+    long length; // of the value
 } XmlIndex;
 
+// the index is only used while the XML file still has the size and modification time recorded here
+typedef struct {
+    char magic[8];
+    long long file_size;
+    long long mtime_sec;
+    long long mtime_nsec;
+    unsigned slot_size; // sizeof(XmlIndex) of the writer
+    unsigned slot_count;
+    unsigned key_count;
+} XmlIndexHeader;
+
+#ifdef __APPLE__
+#define JXSL_MTIME(info) ((info).st_mtimespec)
+#else
+#define JXSL_MTIME(info) ((info).st_mtim)
+#endif
+
+static const char XML_INDEX_MAGIC[8] = {'J', 'X', 'S', 'L', 'X', 'I', 'X', '1'};
+
 #pragma region file_operations
 // Helper function for file operations
 static FILE* open_file(const char* filename, const char* mode) {
@@ -40,85 +72,672 @@ bool create_file(const char* filename, const char* format) {
     fclose(file);
     return true;
 }
-#pragma endregion
 
-#pragma region iterators
-// Function to find keys in a JSON or XML file
-bool find_keys(const char* filename, char** keys, int* num_keys) {
-    FILE* file = fopen(filename, "r");
-    if (!file) {
-        perror("Error opening file");
-        return false;
+// Search a byte range that is not NUL-terminated (a mapping ends exactly where the file does)
+static const char* find_bytes(const char* data, size_t size, const char* needle, size_t needle_len) {
+    if (needle_len == 0 || needle_len > size) return NULL;
+    const char* last = data + size - needle_len;
+    for (const char* at = data; at <= last; at++) {
+        at = memchr(at, needle[0], (size_t)(last - at) + 1);
+        if (!at) return NULL;
+        if (memcmp(at, needle, needle_len) == 0) return at;
     }
+    return NULL;
+}
 
-    char buffer[1024];
-    int key_count = 0;
-    bool is_json = strstr(filename, ".json") != NULL;
+static const char* skip_spaces(const char* p, const char* end) {
+    while (p < end && isspace((unsigned char)*p)) p++;
+    return p;
+}
+
+// Closing quote of the string opening at 'quote', or NULL
+static const char* json_string_end(const char* quote, const char* end) {
+    for (const char* p = quote + 1; p < end; p += *p == '\\' ? 2 : 1) {
+        if (*p == '"') return p;
+    }
+    return NULL;
+}
 
-    while (fscanf(file, "%s", buffer) != EOF) {
-        if (is_json) {
-            // For JSON: Look for "key": patterns
-            if (strchr(buffer, ':')) {
-                char* key = strtok(buffer, ":");
-                if (key && key[0] == '\"' && key[strlen(key) - 1] == '\"') {
-                    key[strlen(key) - 1] = '\0'; // Remove trailing quote
-                    keys[key_count++] = strdup(key + 1); // Skip leading quote
+// Top-level members of a JSON object: visit(context, key, key length, value offset, value length) for each, where the
+// value of a string is the text between its quotes and any other value is taken whole (objects and arrays included)
+static void scan_json_members(const char* map, size_t size,
+                              bool (*visit)(void*, const char*, size_t, size_t, size_t), void* context) {
+    const char* end = map + size;
+    const char* p = memchr(map, '{', size);
+    if (!p) return;
+    for (p++;; p++) { // p is on the brace or on the comma in front of the next member
+        p = skip_spaces(p, end);
+        if (p == end || *p != '"') return;
+        const char* key = p + 1;
+        const char* key_end = json_string_end(p, end);
+        if (!key_end) return;
+        p = skip_spaces(key_end + 1, end);
+        if (p == end || *p != ':') return;
+        p = skip_spaces(p + 1, end);
+        if (p == end) return;
+
+        const char* value = p;
+        const char* value_end;
+        if (*p == '"') {
+            value = p + 1;
+            value_end = json_string_end(p, end);
+            if (!value_end) return;
+            p = value_end + 1;
+        } else if (*p == '{' || *p == '[') {
+            int depth = 0;
+            for (; p < end; p++) {
+                if (*p == '"') {
+                    p = json_string_end(p, end);
+                    if (!p) return;
+                } else if (*p == '{' || *p == '[') {
+                    depth++;
+                } else if ((*p == '}' || *p == ']') && --depth == 0) {
+                    break;
                 }
             }
+            if (p == end) return;
+            value_end = ++p;
         } else {
-            // For XML: Look for <key> patterns
-            if (buffer[0] == '<' && buffer[1] != '/') {
-                char* key_end = strchr(buffer, '>');
-                if (key_end) {
-                    *key_end = '\0'; // Null-terminate the key
-                    keys[key_count++] = strdup(buffer + 1); // Skip leading '<'
-                }
-            }
+            while (p < end && *p != ',' && *p != '}' && !isspace((unsigned char)*p)) p++;
+            value_end = p;
         }
+        if (!visit(context, key, (size_t)(key_end - key), (size_t)(value - map), (size_t)(value_end - value))) return;
+        p = skip_spaces(p, end);
+        if (p == end || *p != ',') return;
+    }
+}
 
-        if (key_count >= *num_keys) break; // Prevent overflow
+// Top-level elements of an XML document: visit(context, key, key length, value offset, value length) for each
+static void scan_xml_members(const char* map, size_t size,
+                             bool (*visit)(void*, const char*, size_t, size_t, size_t), void* context) {
+    const char* end = map + size;
+    const char* p = map;
+    bool in_root = false;
+    while (p < end && (p = memchr(p, '<', (size_t)(end - p)))) {
+        if (p + 1 < end && (p[1] == '?' || p[1] == '!')) { // prolog, comment or doctype
+            const char* close = memchr(p, '>', (size_t)(end - p));
+            if (!close) return;
+            p = close + 1;
+            continue;
+        }
+        const char* close = memchr(p, '>', (size_t)(end - p));
+        if (!close) return;
+        if (!in_root) { // the root element itself
+            if (close[-1] == '/') return;
+            in_root = true;
+            p = close + 1;
+            continue;
+        }
+        if (p + 1 < end && p[1] == '/') return; // end of the root
+
+        const char* name = p + 1;
+        const char* name_end = name;
+        while (name_end < close && !isspace((unsigned char)*name_end) && *name_end != '/') name_end++;
+        size_t name_len = (size_t)(name_end - name);
+        const char* value = close + 1;
+        if (close[-1] == '/') { // self-closing: empty value
+            if (!visit(context, name, name_len, (size_t)(value - map), 0)) return;
+            p = value;
+            continue;
+        }
+        // the matching end tag: </name>
+        const char* value_end = value;
+        while ((value_end = find_bytes(value_end, (size_t)(end - value_end), "</", 2))) {
+            const char* tag = value_end + 2;
+            if ((size_t)(end - tag) > name_len && memcmp(tag, name, name_len) == 0 && tag[name_len] == '>') break;
+            value_end += 2;
+        }
+        if (!value_end) return;
+        if (!visit(context, name, name_len, (size_t)(value - map), (size_t)(value_end - value))) return;
+        p = value_end + 3 + name_len;
     }
+}
 
-    *num_keys = key_count;
-    fclose(file);
+#ifndef _WIN32
+// Locate the value of a JSON member in a mapping: [*start, *end) is the text between the quotes of a string value,
+// or the whole literal of any other value
+static bool locate_json_value(const char* map, size_t size, const char* key, size_t* start, size_t* end) {
+    const char* map_end = map + size;
+    size_t key_len = strlen(key);
+    for (const char* at = map; (at = find_bytes(at, (size_t)(map_end - at), key, key_len)); at++) {
+        // the exact key: quoted on both sides and followed by a colon
+        const char* p = at + key_len;
+        if (at == map || at[-1] != '"' || p == map_end || *p != '"') continue;
+        for (p++; p < map_end && isspace((unsigned char)*p); p++) {}
+        if (p == map_end || *p != ':') continue;
+        for (p++; p < map_end && isspace((unsigned char)*p); p++) {}
+        if (p == map_end) return false;
+
+        const char* q = p;
+        if (*p == '"') {
+            for (q = ++p; q < map_end && *q != '"'; q += *q == '\\' ? 2 : 1) {}
+            if (q >= map_end) return false;
+        } else {
+            while (q < map_end && *q != ',' && *q != '}' && !isspace((unsigned char)*q)) q++;
+        }
+        *start = (size_t)(p - map);
+        *end = (size_t)(q - map);
+        return true;
+    }
+    return false;
+}
+
+// A byte range [begin, end) of a file
+typedef struct {
+    size_t begin;
+    size_t end;
+} ByteRange;
+
+static bool write_all(int fd, const char* data, size_t len) {
+    while (len > 0) {
+        ssize_t written = write(fd, data, len);
+        if (written < 0 && errno == EINTR) continue;
+        if (written < 0) return false;
+        data += written;
+        len -= (size_t)written;
+    }
     return true;
 }
 
-// Function to iterate through all keys in a JSON or XML file
-bool iterate_keys(const char* filename) {
-    FILE* file = fopen(filename, "r");
+// Replace the file with a new version of it: the bytes of *map without the sorted, disjoint 'removed' ranges, with
+// 'insert' put in at 'insert_at' (not inside a removed range). The new version is written to a temporary file that is
+// renamed over the old one, so whoever still has the old file open or mapped (the C++ library, another handle) keeps
+// seeing it whole. On success *fd, *map and *size describe the new file; on failure nothing changed
+static bool replace_file(const char* filename, int* fd, char** map, size_t* size, const ByteRange* removed,
+                         size_t count, size_t insert_at, const char* insert, size_t insert_len) {
+    size_t new_size = *size + insert_len;
+    for (size_t i = 0; i < count; i++) new_size -= removed[i].end - removed[i].begin;
+    size_t name_len = strlen(filename);
+    char* temporary = malloc(name_len + 8);
+    if (!temporary) {
+        perror("Error allocating memory");
+        return false;
+    }
+    memcpy(temporary, filename, name_len);
+    memcpy(temporary + name_len, ".XXXXXX", 8);
+    int out = mkstemp(temporary);
+    if (out < 0) {
+        perror("Error creating temporary file");
+        free(temporary);
+        return false;
+    }
+    struct stat info;
+    if (fstat(*fd, &info) == 0 && fchmod(out, info.st_mode & 07777) != 0) {} // keep the permissions of the old file
+
+    // the kept pieces in file order, with the insertion in front of the first piece that ends at or behind it
+    bool written = true;
+    bool inserted = insert_len == 0;
+    size_t from = 0;
+    for (size_t i = 0; i <= count && written; i++) {
+        size_t to = i < count ? removed[i].begin : *size;
+        if (!inserted && insert_at <= to) {
+            written = write_all(out, *map + from, insert_at - from) && write_all(out, insert, insert_len);
+            from = insert_at;
+            inserted = true;
+        }
+        written = written && write_all(out, *map + from, to - from);
+        if (i < count) from = removed[i].end;
+    }
+    char* replaced = MAP_FAILED;
+    if (written && new_size > 0) replaced = mmap(NULL, new_size, PROT_READ | PROT_WRITE, MAP_SHARED, out, 0);
+    if (!written || (new_size > 0 && replaced == MAP_FAILED) || rename(temporary, filename) != 0) {
+        perror("Error writing file");
+        if (replaced != MAP_FAILED) munmap(replaced, new_size);
+        close(out);
+        unlink(temporary);
+        free(temporary);
+        return false;
+    }
+    free(temporary);
+    if (*map) munmap(*map, *size);
+    close(*fd);
+    *fd = out;
+    *map = new_size > 0 ? replaced : NULL;
+    *size = new_size;
+    return true;
+}
+
+static unsigned hash_key(const char* key, size_t key_len) { // FNV-1a: stable across builds, the XML index stores it
+    unsigned hash = 2166136261u;
+    for (size_t i = 0; i < key_len; i++) hash = (hash ^ (unsigned char)key[i]) * 16777619u;
+    return hash;
+}
+
+// End of a JSON value as found by the scanner: behind the closing quote of a string and the padding of earlier edits
+static size_t json_value_end(const char* map, size_t size, size_t value_at, size_t value_len) {
+    size_t end = value_at + value_len;
+    if (map[value_at - 1] == '"' && end < size && map[end] == '"') end++; // a string
+    while (end < size && (map[end] == ' ' || map[end] == '\t')) end++; // edit padding
+    return end;
+}
+
+// Bytes a top-level member occupies, as found by the scanners above: removing [*begin, *end) leaves a valid document.
+// A JSON member takes the comma in front of it (the first one the comma behind it), an XML element its line
+static void member_range(const char* map, size_t size, bool is_json, size_t key_at, size_t key_len, size_t value_at,
+                         size_t value_len, size_t* begin, size_t* end) {
+    if (is_json) {
+        size_t key_quote = key_at - 1;
+        size_t value_end = json_value_end(map, size, value_at, value_len);
+        size_t before = key_quote;
+        while (before > 0 && isspace((unsigned char)map[before - 1])) before--;
+        if (before > 0 && map[before - 1] == ',') {
+            *begin = before - 1;
+            *end = value_end;
+            return;
+        }
+        const char* after = skip_spaces(map + value_end, map + size);
+        if (after < map + size && *after == ',') { // the first member: up to the next one
+            *begin = key_quote;
+            *end = (size_t)(skip_spaces(after + 1, map + size) - map);
+        } else { // the only member
+            *begin = before;
+            *end = value_end;
+        }
+        return;
+    }
+    bool self_closing = value_len == 0 && map[value_at - 2] == '/';
+    size_t element = key_at - 1;
+    while (element > 0 && (map[element - 1] == ' ' || map[element - 1] == '\t')) element--;
+    if (element > 0 && map[element - 1] == '\n') element--;
+    if (element > 0 && map[element - 1] == '\r') element--;
+    size_t after = self_closing ? value_at : value_at + value_len + key_len + 3; // behind "</key>"
+    while (after < size && (map[after] == ' ' || map[after] == '\t')) after++; // edit padding
+    *begin = element;
+    *end = after;
+}
+#endif
+#pragma endregion
+
+#ifndef _WIN32
+#pragma region xml_index
+static void xml_index_path(const char* filename, char* path, size_t path_size) {
+    snprintf(path, path_size, "%s.idx", filename);
+}
+
+static bool xml_index_read_slot(int fd, unsigned slot, XmlIndex* entry) {
+    off_t at = (off_t)(sizeof(XmlIndexHeader) + (size_t)slot * sizeof(XmlIndex));
+    return pread(fd, entry, sizeof(*entry), at) == (ssize_t)sizeof(*entry);
+}
+
+static bool xml_index_write_slot(int fd, unsigned slot, const XmlIndex* entry) {
+    off_t at = (off_t)(sizeof(XmlIndexHeader) + (size_t)slot * sizeof(XmlIndex));
+    return pwrite(fd, entry, sizeof(*entry), at) == (ssize_t)sizeof(*entry);
+}
+
+// Record the current size and modification time of the XML file: the index describes these contents now
+static bool xml_index_stamp(int fd, XmlIndexHeader* header, const char* filename) {
+    struct stat info;
+    if (stat(filename, &info) != 0) return false;
+    header->file_size = (long long)info.st_size;
+    header->mtime_sec = (long long)JXSL_MTIME(info).tv_sec;
+    header->mtime_nsec = (long long)JXSL_MTIME(info).tv_nsec;
+    return pwrite(fd, header, sizeof(*header), 0) == (ssize_t)sizeof(*header);
+}
+
+// Slot holding the key (true) or the empty slot where it would go (false); keys that do not fit a slot never match
+static bool xml_index_find(int fd, const XmlIndexHeader* header, const char* key, XmlIndex* entry, unsigned* slot) {
+    size_t key_len = strlen(key);
+    unsigned mask = header->slot_count - 1;
+    unsigned i = hash_key(key, key_len) & mask;
+    for (unsigned probes = 0; probes < header->slot_count; probes++, i = (i + 1) & mask) {
+        if (!xml_index_read_slot(fd, i, entry)) return false;
+        *slot = i;
+        if (entry->position < 0) return false;
+        if (strncmp(entry->key, key, sizeof(entry->key)) == 0) return true;
+    }
+    return false;
+}
+
+typedef struct {
+    int fd;
+    XmlIndexHeader* header; // NULL: only count the keys
+    unsigned count;
+    bool failed;
+} XmlIndexBuild;
+
+static bool xml_index_add_member(void* context, const char* key, size_t key_len, size_t position, size_t length) {
+    XmlIndexBuild* build = context;
+    if (key_len >= sizeof(((XmlIndex*)NULL)->key)) return true; // found by scanning instead
+    if (!build->header) {
+        build->count++;
+        return true;
+    }
+    XmlIndex entry;
+    unsigned mask = build->header->slot_count - 1;
+    for (unsigned i = hash_key(key, key_len) & mask;; i = (i + 1) & mask) {
+        if (!xml_index_read_slot(build->fd, i, &entry)) {
+            build->failed = true;
+            return false;
+        }
+        if (entry.position < 0) {
+            memset(&entry, 0, sizeof(entry));
+            memcpy(entry.key, key, key_len);
+            entry.position = (long)position;
+            entry.length = (long)length;
+            build->header->key_count++;
+            build->failed = !xml_index_write_slot(build->fd, i, &entry);
+            return !build->failed;
+        }
+        if (strlen(entry.key) == key_len && memcmp(entry.key, key, key_len) == 0) return true; // the first one counts
+    }
+}
+
+// Scan the XML file and write its index from scratch; returns the open index, or -1
+static int xml_index_build(const char* filename, XmlIndexHeader* header) {
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0) return -1;
+    struct stat info;
+    if (fstat(fd, &info) != 0) {
+        close(fd);
+        return -1;
+    }
+    size_t size = (size_t)info.st_size;
+    char* map = size > 0 ? mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0) : NULL;
+    close(fd);
+    if (map == MAP_FAILED) return -1;
+
+    XmlIndexBuild count = {-1, NULL, 0, false};
+    if (map) scan_xml_members(map, size, xml_index_add_member, &count);
+    memset(header, 0, sizeof(*header));
+    memcpy(header->magic, XML_INDEX_MAGIC, sizeof(header->magic));
+    header->slot_size = sizeof(XmlIndex);
+    header->slot_count = 16;
+    while (header->slot_count < 2 * count.count) header->slot_count *= 2; // at most half full
+
+    char path[4096];
+    xml_index_path(filename, path, sizeof(path));
+    int index = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    XmlIndex empty;
+    memset(&empty, 0, sizeof(empty));
+    empty.position = -1;
+    bool written = index >= 0;
+    for (unsigned i = 0; written && i < header->slot_count; i++) written = xml_index_write_slot(index, i, &empty);
+    XmlIndexBuild fill = {index, header, 0, false};
+    if (written && map) scan_xml_members(map, size, xml_index_add_member, &fill);
+    if (map) munmap(map, size);
+    // the header goes last: an index written only partly never validates
+    if (!written || fill.failed || !xml_index_stamp(index, header, filename)) {
+        if (index >= 0) {
+            close(index);
+            unlink(path);
+        }
+        return -1;
+    }
+    return index;
+}
+
+// The index of an XML file, checked against the file's size and modification time and rebuilt when it does not
+// match; -1 if there is none
+static int xml_index_open(const char* filename, XmlIndexHeader* header) {
+    char path[4096];
+    xml_index_path(filename, path, sizeof(path));
+    int index = open(path, O_RDWR);
+    struct stat info;
+    if (index >= 0 && stat(filename, &info) == 0 &&
+        pread(index, header, sizeof(*header), 0) == (ssize_t)sizeof(*header) &&
+        memcmp(header->magic, XML_INDEX_MAGIC, sizeof(header->magic)) == 0 && header->slot_size == sizeof(XmlIndex) &&
+        header->slot_count > 0 && (header->slot_count & (header->slot_count - 1)) == 0 &&
+        header->file_size == (long long)info.st_size && header->mtime_sec == (long long)JXSL_MTIME(info).tv_sec &&
+        header->mtime_nsec == (long long)JXSL_MTIME(info).tv_nsec) {
+        return index;
+    }
+    if (index >= 0) close(index);
+    return xml_index_build(filename, header);
+}
+
+// Point the key at a new value range after the XML file was changed (the index was opened before the change)
+static void xml_index_put(int fd, XmlIndexHeader* header, const char* filename, const char* key, long position,
+                          long length) {
+    XmlIndex entry;
+    unsigned slot;
+    bool found = strlen(key) < sizeof(entry.key) && xml_index_find(fd, header, key, &entry, &slot);
+    if (!found && (strlen(key) >= sizeof(entry.key) || 2 * (header->key_count + 1) > header->slot_count)) {
+        int rebuilt = xml_index_build(filename, header); // too full (or a key only found by scanning): start over
+        if (rebuilt >= 0) close(rebuilt);
+        return;
+    }
+    if (!found) {
+        memset(&entry, 0, sizeof(entry));
+        strcpy(entry.key, key);
+        header->key_count++;
+    }
+    entry.position = position;
+    entry.length = length;
+    if (!xml_index_write_slot(fd, slot, &entry) || !xml_index_stamp(fd, header, filename)) {
+        char path[4096];
+        xml_index_path(filename, path, sizeof(path));
+        unlink(path); // rebuilt on the next use
+    }
+}
+
+// Values behind 'after' moved by 'delta' bytes
+static bool xml_index_shift(int fd, const XmlIndexHeader* header, long after, long delta) {
+    XmlIndex slots[64];
+    for (unsigned first = 0; first < header->slot_count; first += 64) {
+        unsigned count = header->slot_count - first < 64 ? header->slot_count - first : 64;
+        off_t at = (off_t)(sizeof(XmlIndexHeader) + (size_t)first * sizeof(XmlIndex));
+        ssize_t bytes = (ssize_t)(count * sizeof(XmlIndex));
+        if (pread(fd, slots, (size_t)bytes, at) != bytes) return false;
+        for (unsigned i = 0; i < count; i++) {
+            if (slots[i].position > after) slots[i].position += delta;
+        }
+        if (pwrite(fd, slots, (size_t)bytes, at) != bytes) return false;
+    }
+    return true;
+}
+#pragma endregion
+#endif
+
+#pragma region iterators
+// The contents of a file for one pass of a scanner. POSIX maps it for sequential access, so read-ahead streams it
+// through in chunks and nothing is copied; elsewhere it is read whole. *map is NULL for an empty file
+static bool load_file(const char* filename, char** map, size_t* size) {
+    *map = NULL;
+    *size = 0;
+#ifndef _WIN32
+    int fd = open(filename, O_RDONLY);
+    struct stat info;
+    if (fd < 0 || fstat(fd, &info) != 0) {
+        perror("Error opening file");
+        if (fd >= 0) close(fd);
+        return false;
+    }
+    if (info.st_size > 0) {
+        char* mapped = mmap(NULL, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (mapped == MAP_FAILED) {
+            perror("Error mapping file");
+            close(fd);
+            return false;
+        }
+        madvise(mapped, (size_t)info.st_size, MADV_SEQUENTIAL);
+        *map = mapped;
+        *size = (size_t)info.st_size;
+    }
+    close(fd);
+    return true;
+#else
+    FILE* file = fopen(filename, "rb");
     if (!file) {
         perror("Error opening file");
         return false;
     }
+    fseek(file, 0, SEEK_END);
+    long length = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    if (length > 0) {
+        *map = malloc((size_t)length);
+        if (!*map || fread(*map, 1, (size_t)length, file) != (size_t)length) {
+            fprintf(stderr, "Error: Could not read %s\n", filename);
+            free(*map);
+            *map = NULL;
+            fclose(file);
+            return false;
+        }
+        *size = (size_t)length;
+    }
+    fclose(file);
+    return true;
+#endif
+}
 
-    char buffer[1024];
-    bool is_json = strstr(filename, ".json") != NULL;
+static void unload_file(char* map, size_t size) {
+#ifndef _WIN32
+    if (map) munmap(map, size);
+#else
+    (void)size;
+    free(map);
+#endif
+}
 
-    printf("Iterating keys:\n");
-    while (fscanf(file, "%s", buffer) != EOF) {
-        if (is_json) {
-            // For JSON: Look for "key": patterns
-            if (strchr(buffer, ':')) {
-                char* key = strtok(buffer, ":");
-                if (key && key[0] == '\"' && key[strlen(key) - 1] == '\"') {
-                    key[strlen(key) - 1] = '\0'; // Remove trailing quote
-                    printf("Key: %s\n", key + 1); // Skip leading quote
-                }
-            }
-        } else {
-            // For XML: Look for <key> patterns
-            if (buffer[0] == '<' && buffer[1] != '/') {
-                char* key_end = strchr(buffer, '>');
-                if (key_end) {
-                    *key_end = '\0'; // Null-terminate the key
-                    printf("Key: %s\n", buffer + 1); // Skip leading '<'
-                }
-            }
+// A key_list while it is filled: the key text grows in list->text, the offsets in a separate array until the end
+typedef struct {
+    key_list* list;
+    size_t text_size;
+    size_t text_capacity;
+    size_t offset_capacity;
+    bool failed;
+} KeyListBuild;
+
+static void key_list_start(KeyListBuild* build, key_list* list) {
+    memset(list, 0, sizeof(*list));
+    memset(build, 0, sizeof(*build));
+    build->list = list;
+}
+
+static bool key_list_add(KeyListBuild* build, const char* key, size_t key_len) {
+    key_list* list = build->list;
+    if (build->text_size + key_len + 1 > build->text_capacity) {
+        size_t capacity = build->text_capacity ? build->text_capacity : 4096;
+        while (capacity < build->text_size + key_len + 1) capacity *= 2;
+        char* text = realloc(list->text, capacity);
+        if (!text) {
+            build->failed = true;
+            return false;
+        }
+        list->text = text;
+        build->text_capacity = capacity;
+    }
+    if (list->count == build->offset_capacity) {
+        size_t capacity = build->offset_capacity ? 2 * build->offset_capacity : 256;
+        size_t* offsets = realloc(list->offsets, capacity * sizeof(size_t));
+        if (!offsets) {
+            build->failed = true;
+            return false;
         }
+        list->offsets = offsets;
+        build->offset_capacity = capacity;
     }
+    list->offsets[list->count++] = build->text_size;
+    memcpy(list->text + build->text_size, key, key_len);
+    list->text[build->text_size + key_len] = '\0';
+    build->text_size += key_len + 1;
+    return true;
+}
 
-    fclose(file);
+static bool key_list_visit(void* context, const char* key, size_t key_len, size_t value_at, size_t value_len) {
+    (void)value_at, (void)value_len;
+    return key_list_add(context, key, key_len);
+}
+
+// Move the offsets behind the key text, so that the whole list is the one allocation list->text
+static bool key_list_finish(KeyListBuild* build) {
+    key_list* list = build->list;
+    if (!build->failed && list->count > 0) {
+        size_t at = (build->text_size + sizeof(size_t) - 1) / sizeof(size_t) * sizeof(size_t);
+        char* text = realloc(list->text, at + list->count * sizeof(size_t));
+        if (text) {
+            memcpy(text + at, list->offsets, list->count * sizeof(size_t));
+            free(list->offsets);
+            list->text = text;
+            list->offsets = (size_t*)(text + at);
+            return true;
+        }
+        build->failed = true;
+    }
+    free(list->offsets);
+    list->offsets = NULL;
+    if (build->failed) {
+        fprintf(stderr, "Error: Out of memory while listing keys\n");
+        free(list->text);
+        list->text = NULL;
+        list->count = 0;
+        return false;
+    }
+    return true;
+}
+
+static void scan_members(const char* map, size_t size, bool is_json,
+                         bool (*visit)(void*, const char*, size_t, size_t, size_t), void* context) {
+    if (!map) return;
+    if (is_json) {
+        scan_json_members(map, size, visit, context);
+    } else {
+        scan_xml_members(map, size, visit, context);
+    }
+}
+
+// Function to list the top-level keys of a JSON or XML file in one scan, with no limit on their number or length
+bool list_keys(const char* filename, key_list* keys) {
+    KeyListBuild build;
+    key_list_start(&build, keys);
+    char* map;
+    size_t size;
+    if (!load_file(filename, &map, &size)) return false;
+    scan_members(map, size, strstr(filename, ".json") != NULL, key_list_visit, &build);
+    unload_file(map, size);
+    return key_list_finish(&build);
+}
+
+void free_key_list(key_list* keys) {
+    free(keys->text); // the offsets live in the same allocation
+    memset(keys, 0, sizeof(*keys));
+}
+
+// Copies of the keys into an array of *num_keys entries; false (with the number needed in *num_keys) if it is smaller
+static bool copy_keys(const key_list* list, char** keys, int* num_keys) {
+    if (list->count > (size_t)*num_keys) {
+        fprintf(stderr, "Error: %zu keys do not fit in an array of %d\n", list->count, *num_keys);
+        *num_keys = list->count > INT_MAX ? INT_MAX : (int)list->count;
+        return false;
+    }
+    for (size_t i = 0; i < list->count; i++) {
+        const char* key = list->text + list->offsets[i];
+        size_t length = strlen(key) + 1;
+        keys[i] = malloc(length);
+        if (!keys[i]) {
+            fprintf(stderr, "Error: Out of memory while listing keys\n");
+            while (i > 0) free(keys[--i]);
+            return false;
+        }
+        memcpy(keys[i], key, length);
+    }
+    *num_keys = (int)list->count;
+    return true;
+}
+
+// Function to find keys in a JSON or XML file; each key is a separate allocation, freed by the caller
+bool find_keys(const char* filename, char** keys, int* num_keys) {
+    key_list list;
+    if (!list_keys(filename, &list)) return false;
+    bool copied = copy_keys(&list, keys, num_keys);
+    free_key_list(&list);
+    return copied;
+}
+
+static bool print_key(void* context, const char* key, size_t key_len, size_t value_at, size_t value_len) {
+    (void)context, (void)value_at, (void)value_len;
+    printf("Key: %.*s\n", (int)key_len, key);
+    return true;
+}
+
+// Function to iterate through all keys in a JSON or XML file
+bool iterate_keys(const char* filename) {
+    char* map;
+    size_t size;
+    if (!load_file(filename, &map, &size)) return false;
+    printf("Iterating keys:\n");
+    scan_members(map, size, strstr(filename, ".json") != NULL, print_key, NULL);
+    unload_file(map, size);
     return true;
 }
 #pragma endregion
@@ -179,6 +798,23 @@ bool read_data_json(const char* filename, const char* key, char* value) {
 
 // Read data for XML files
 bool read_data_xml(const char* filename, const char* key, char* value) {
+#ifndef _WIN32
+    // keyed access through the index: a few small reads of the index and one pread of the value
+    XmlIndexHeader header;
+    int index = xml_index_open(filename, &header);
+    if (index >= 0 && strlen(key) < sizeof(((XmlIndex*)NULL)->key)) {
+        XmlIndex entry;
+        unsigned slot;
+        bool found = xml_index_find(index, &header, key, &entry, &slot);
+        close(index);
+        int fd = found ? open(filename, O_RDONLY) : -1;
+        found = fd >= 0 && pread(fd, value, (size_t)entry.length, entry.position) == (ssize_t)entry.length;
+        if (fd >= 0) close(fd);
+        if (found) value[entry.length] = '\0';
+        return found;
+    }
+    if (index >= 0) close(index);
+#endif
     FILE* file = fopen(filename, "r");
     if (!file) {
         perror("Error opening file");
@@ -232,8 +868,9 @@ bool add_data_json(const char* filename, const char* key, const char* value) {
     buffer[file_size] = '\0'; // Null-terminate the buffer
     fclose(file);
 
-    // Check if the file is empty or contains just '{}'
-    bool is_empty_json = (strcmp(buffer, "{}") == 0 || buffer[0] == '\0');
+    // Check if the file is empty or is an object with only whitespace inside, as deleting its last member leaves it
+    const char* content = skip_spaces(buffer, buffer + file_size);
+    bool is_empty_json = *content == '\0' || (*content == '{' && *skip_spaces(content + 1, buffer + file_size) == '}');
 
     // Open the file in write mode
     file = fopen(filename, "w");
@@ -264,30 +901,62 @@ bool add_data_xml(const char* filename, const char* key, const char* value) {
     if (!file) return false;
 
     // Read the entire file content into memory
-    char buffer[4096] = {0};
-    fread(buffer, sizeof(char), sizeof(buffer) - 1, file);
+    fseek(file, 0, SEEK_END);
+    long file_size = ftell(file);
+    rewind(file);
+    char* buffer = malloc(file_size + 1);
+    if (!buffer) {
+        fclose(file);
+        perror("Error allocating memory");
+        return false;
+    }
+    size_t read = fread(buffer, sizeof(char), file_size, file);
+    buffer[read] = '\0';
     fclose(file);
 
     // Check if the file is empty or contains just "<root></root>"
     bool is_empty_xml = (strcmp(buffer, "<root></root>") == 0 || buffer[0] == '\0');
+#ifndef _WIN32
+    XmlIndexHeader header;
+    int index = xml_index_open(filename, &header); // it has to describe the file as it was before the change
+#endif
 
     // Open the file in write mode
     file = open_file(filename, "w");
-    if (!file) return false;
+    if (!file) {
+        free(buffer);
+#ifndef _WIN32
+        if (index >= 0) close(index);
+#endif
+        return false;
+    }
 
+    long position = -1; // where the value is written
     if (is_empty_xml) {
         // If the file is empty or contains only "<root></root>", add the first key-value pair
-        fprintf(file, "<root>\n    <%s>%s</%s>\n</root>", key, value, key);
+        fprintf(file, "<root>\n    <%s>", key);
+        position = ftell(file);
+        fprintf(file, "%s</%s>\n</root>", value, key);
     } else {
         // Otherwise, remove the closing "</root>" and append the new key-value pair
         char* closing_tag = strstr(buffer, "</root>");
         if (closing_tag) {
             *closing_tag = '\0'; // Truncate the buffer before "</root>"
-            fprintf(file, "%s    <%s>%s</%s>\n</root>", buffer, key, value, key);
+            fprintf(file, "%s    <%s>", buffer, key);
+            position = ftell(file);
+            fprintf(file, "%s</%s>\n</root>", value, key);
         }
     }
 
+    free(buffer);
     fclose(file);
+#ifndef _WIN32
+    if (index >= 0) {
+        // the members in front of the new one did not move
+        if (position >= 0) xml_index_put(index, &header, filename, key, position, (long)strlen(value));
+        close(index);
+    }
+#endif
     return true;
 }
 #pragma endregion
@@ -312,6 +981,7 @@ bool edit_data(const char* filename, const char* key, const char* new_value) {
 }
 
 // Edit data by a given key (optimized with mapping to avoid rewriting the file every time to edit)
+#ifdef _WIN32
 bool edit_data_json(const char* filename, const char* key, const char* new_value) {
     HANDLE hFile = CreateFileA(
         filename, GENERIC_READ | GENERIC_WRITE, 0, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
@@ -384,8 +1054,60 @@ bool edit_data_json(const char* filename, const char* key, const char* new_value
     CloseHandle(hFile);
     return true;
 }
+#else
+bool edit_data_json(const char* filename, const char* key, const char* new_value) {
+    int fd = open(filename, O_RDWR);
+    if (fd < 0) {
+        perror("Error opening file");
+        return false;
+    }
+
+    struct stat info;
+    if (fstat(fd, &info) != 0 || info.st_size == 0) {
+        close(fd);
+        return false;
+    }
+    size_t size = (size_t)info.st_size;
+    char* map = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (map == MAP_FAILED) {
+        close(fd);
+        perror("Error mapping file");
+        return false;
+    }
+
+    size_t start, end;
+    if (!locate_json_value(map, size, key, &start, &end)) {
+        munmap(map, size);
+        close(fd);
+        return false; // Key not found
+    }
+    bool quoted = end < size && map[end] == '"';
+    size_t old_len = end - start;
+    size_t new_len = strlen(new_value);
+
+    if (new_len <= old_len) {
+        // Fits: overwrite in place, the rest of the old value becomes whitespace behind the closing quote
+        memcpy(map + start, new_value, new_len);
+        if (quoted) map[start + new_len] = '"';
+        memset(map + start + new_len + (quoted ? 1 : 0), ' ', old_len - new_len);
+    } else {
+        // Longer: the members behind it move, in a new version of the file that replaces this one
+        ByteRange old_range = {start, end};
+        if (!replace_file(filename, &fd, &map, &size, &old_range, 1, start, new_value, new_len)) {
+            munmap(map, size);
+            close(fd);
+            return false;
+        }
+    }
+
+    munmap(map, size);
+    close(fd);
+    return true;
+}
+#endif
 
 // Edit data by a given key (optimized with Indexing to avoid rewriting the file every time to edit)
+#ifdef _WIN32
 bool edit_data_xml(const char* filename, const char* key, const char* new_value) {
     // Open file in read+write mode
     FILE* file = fopen(filename, "r+");
@@ -419,6 +1141,88 @@ bool edit_data_xml(const char* filename, const char* key, const char* new_value)
     fclose(file);
     return updated;
 }
+#else
+typedef struct {
+    const char* key;
+    long position;
+    long length;
+} XmlMemberSearch;
+
+static bool match_xml_member(void* context, const char* key, size_t key_len, size_t position, size_t length) {
+    XmlMemberSearch* search = context;
+    if (strlen(search->key) != key_len || memcmp(search->key, key, key_len) != 0) return true;
+    search->position = (long)position;
+    search->length = (long)length;
+    return false;
+}
+
+bool edit_data_xml(const char* filename, const char* key, const char* new_value) {
+    XmlIndexHeader header;
+    int index = xml_index_open(filename, &header);
+    int fd = open(filename, O_RDWR);
+    if (fd < 0) {
+        if (index >= 0) close(index);
+        perror("Error opening file");
+        return false;
+    }
+    struct stat info;
+    size_t size = fstat(fd, &info) == 0 ? (size_t)info.st_size : 0;
+    char* map = size > 0 ? mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0) : MAP_FAILED;
+    if (map == MAP_FAILED) {
+        if (index >= 0) close(index);
+        close(fd);
+        return false;
+    }
+
+    // the value's range from the index, or from a scan of the mapping
+    XmlMemberSearch member = {key, -1, 0};
+    XmlIndex entry;
+    unsigned slot;
+    if (index >= 0 && strlen(key) < sizeof(entry.key)) {
+        if (xml_index_find(index, &header, key, &entry, &slot)) {
+            member.position = entry.position;
+            member.length = entry.length;
+        }
+    } else {
+        scan_xml_members(map, size, match_xml_member, &member);
+    }
+    size_t key_len = strlen(key);
+    size_t new_len = strlen(new_value);
+    size_t start = (size_t)member.position;
+    size_t old_len = (size_t)member.length;
+    if (member.position < 0 || start + old_len + key_len + 3 > size) {
+        munmap(map, size);
+        if (index >= 0) close(index);
+        close(fd);
+        return false; // Key not found
+    }
+
+    bool edited = true;
+    ByteRange old_range = {start, start + old_len};
+    if (new_len <= old_len) {
+        // Fits: the value and its end tag move up, the rest of the old member becomes whitespace behind them
+        size_t tail = old_len + key_len + 3; // value and "</key>"
+        memcpy(map + start, new_value, new_len);
+        memcpy(map + start + new_len, "</", 2);
+        memcpy(map + start + new_len + 2, key, key_len);
+        map[start + new_len + 2 + key_len] = '>';
+        memset(map + start + new_len + key_len + 3, ' ', tail - (new_len + key_len + 3));
+    } else if (replace_file(filename, &fd, &map, &size, &old_range, 1, start, new_value, new_len)) {
+        // Longer: written to a new version of the file, in which only the values indexed behind this one moved
+        if (index >= 0) xml_index_shift(index, &header, member.position, (long)(new_len - old_len));
+    } else {
+        edited = false;
+    }
+
+    if (map) munmap(map, size);
+    close(fd);
+    if (index >= 0) {
+        if (edited) xml_index_put(index, &header, filename, key, member.position, (long)new_len);
+        close(index);
+    }
+    return edited;
+}
+#endif
 #pragma endregion
 
 #pragma region delete_data
@@ -441,15 +1245,187 @@ bool delete_data(const char* filename, const char* key) {
     }
 }
 
+#ifndef _WIN32
+// One pass of a batched delete: the members whose keys are in the set, turned into the ranges that remove them
+typedef struct {
+    const char* map;
+    size_t size;
+    bool is_json;
+    const char* const* keys;
+    unsigned* set; // open addressing over the keys: index + 1, 0 for an empty slot
+    unsigned set_mask;
+    ByteRange* ranges; // sorted and disjoint
+    size_t range_count;
+    size_t range_capacity;
+    size_t members; // seen so far
+    int deleted;
+    bool in_run; // JSON: the members just before were deleted; their commas are settled once the run ends
+    bool run_first; // the run started at the first member
+    size_t run_begin;
+    size_t run_end;
+    bool failed;
+} DeleteScan;
+
+static bool delete_scan_wanted(const DeleteScan* scan, const char* key, size_t key_len) {
+    for (unsigned slot = hash_key(key, key_len) & scan->set_mask; scan->set[slot]; slot = (slot + 1) & scan->set_mask) {
+        const char* wanted = scan->keys[scan->set[slot] - 1];
+        if (strncmp(wanted, key, key_len) == 0 && wanted[key_len] == '\0') return true;
+    }
+    return false;
+}
+
+static bool delete_scan_push(DeleteScan* scan, size_t begin, size_t end) {
+    ByteRange* last = scan->range_count > 0 ? &scan->ranges[scan->range_count - 1] : NULL;
+    if (last && begin <= last->end) { // elements on one line both claim the blanks between them
+        if (end > last->end) last->end = end;
+        return true;
+    }
+    if (scan->range_count == scan->range_capacity) {
+        size_t capacity = scan->range_capacity ? 2 * scan->range_capacity : 16;
+        ByteRange* ranges = realloc(scan->ranges, capacity * sizeof(ByteRange));
+        if (!ranges) {
+            scan->failed = true;
+            return false;
+        }
+        scan->ranges = ranges;
+        scan->range_capacity = capacity;
+    }
+    scan->ranges[scan->range_count].begin = begin;
+    scan->ranges[scan->range_count].end = end;
+    scan->range_count++;
+    return true;
+}
+
+// A run of deleted JSON members is removed as one range, so that the commas around it stay right: behind a surviving
+// member the run takes the comma in front of it, at the start of the object the comma behind it
+static bool delete_scan_visit(void* context, const char* key, size_t key_len, size_t value_at, size_t value_len) {
+    DeleteScan* scan = context;
+    size_t key_at = (size_t)(key - scan->map);
+    bool first = scan->members++ == 0;
+    if (!delete_scan_wanted(scan, key, key_len)) {
+        if (scan->in_run) {
+            scan->in_run = false;
+            return delete_scan_push(scan, scan->run_begin, scan->run_first ? key_at - 1 : scan->run_end);
+        }
+        return true;
+    }
+    scan->deleted++;
+    size_t begin, end;
+    member_range(scan->map, scan->size, scan->is_json, key_at, key_len, value_at, value_len, &begin, &end);
+    if (!scan->is_json) return delete_scan_push(scan, begin, end);
+    if (!scan->in_run) {
+        scan->in_run = true;
+        scan->run_first = first;
+        scan->run_begin = first ? key_at - 1 : begin;
+    }
+    scan->run_end = json_value_end(scan->map, scan->size, value_at, value_len);
+    return true;
+}
+
+// Delete the members of all the given keys (every occurrence) in one scan of the mapped file; the members that stay are
+// written to a new version of the file that replaces it
+static bool delete_members(const char* filename, bool is_json, const char* const* keys, int num_keys, int* num_deleted) {
+    if (num_deleted) *num_deleted = 0;
+    int fd = open(filename, O_RDONLY);
+    struct stat info;
+    if (fd < 0 || fstat(fd, &info) != 0) {
+        perror("Error opening file");
+        if (fd >= 0) close(fd);
+        return false;
+    }
+    size_t size = (size_t)info.st_size;
+    if (size == 0 || num_keys <= 0) {
+        close(fd);
+        return false;
+    }
+    char* map = mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0);
+    if (map == MAP_FAILED) {
+        perror("Error mapping file");
+        close(fd);
+        return false;
+    }
+
+    DeleteScan scan;
+    memset(&scan, 0, sizeof(scan));
+    scan.map = map;
+    scan.size = size;
+    scan.is_json = is_json;
+    scan.keys = keys;
+    unsigned slots = 16;
+    while (slots < 2 * (unsigned)num_keys) slots *= 2;
+    scan.set = calloc(slots, sizeof(unsigned));
+    scan.set_mask = slots - 1;
+    if (scan.set) {
+        for (int k = 0; k < num_keys; k++) {
+            size_t key_len = strlen(keys[k]);
+            if (delete_scan_wanted(&scan, keys[k], key_len)) continue; // listed twice
+            unsigned slot = hash_key(keys[k], key_len) & scan.set_mask;
+            while (scan.set[slot]) slot = (slot + 1) & scan.set_mask;
+            scan.set[slot] = (unsigned)k + 1;
+        }
+        scan_members(map, size, is_json, delete_scan_visit, &scan);
+        if (scan.in_run) { // up to the last member: only whitespace stays inside the braces
+            size_t begin = scan.run_begin;
+            if (scan.run_first) {
+                while (begin > 0 && isspace((unsigned char)map[begin - 1])) begin--;
+            }
+            delete_scan_push(&scan, begin, scan.run_end);
+        }
+    }
+    bool ok = scan.set && !scan.failed;
+    if (!ok) fprintf(stderr, "Error: Out of memory while deleting from %s\n", filename);
+
+    if (ok && scan.range_count > 0) {
+        ok = replace_file(filename, &fd, &map, &size, scan.ranges, scan.range_count, 0, NULL, 0);
+    }
+    if (map) munmap(map, size);
+    close(fd);
+    free(scan.set);
+    free(scan.ranges);
+    if (!ok) return false;
+
+    if (!is_json && scan.deleted > 0) {
+        // every member behind a deleted one moved: index the new file
+        XmlIndexHeader header;
+        int index = xml_index_build(filename, &header);
+        if (index >= 0) close(index);
+    }
+    if (num_deleted) *num_deleted = scan.deleted;
+    return scan.deleted > 0;
+}
+
 // Delete data for JSON files
 bool delete_data_json(const char* filename, const char* key) {
+    return delete_members(filename, true, &key, 1, NULL);
+}
+
+// Delete data for XML files
+bool delete_data_xml(const char* filename, const char* key) {
+    return delete_members(filename, false, &key, 1, NULL);
+}
+
+// Delete data for many keys at once
+bool delete_data_batch(const char* filename, const char* const* keys, int num_keys, int* num_deleted) {
+    const char* ext = strrchr(filename, '.');
+    if (!ext || (strcmp(ext, ".json") != 0 && strcmp(ext, ".xml") != 0)) {
+        fprintf(stderr, "Error: Unsupported file type '%s'.\n", ext ? ext : filename);
+        if (num_deleted) *num_deleted = 0;
+        return false;
+    }
+    return delete_members(filename, strcmp(ext, ".json") == 0, keys, num_keys, num_deleted);
+}
+#else
+// Copy every line that does not contain the key through "<file>.tmp", which then replaces the file
+static bool delete_lines(const char* filename, const char* key) {
     FILE* file = fopen(filename, "r");
     if (!file) {
         perror("Error opening file");
         return false;
     }
 
-    FILE* temp_file = fopen("temp.json", "w");
+    char temp_name[4096];
+    snprintf(temp_name, sizeof(temp_name), "%s.tmp", filename);
+    FILE* temp_file = fopen(temp_name, "w");
     if (!temp_file) {
         fclose(file);
         perror("Error opening temporary file");
@@ -473,52 +1449,374 @@ bool delete_data_json(const char* filename, const char* key) {
     // Replace original file with the temporary file
     if (deleted) {
         remove(filename);
-        rename("temp.json", filename);
+        rename(temp_name, filename);
     } else {
-        remove("temp.json");
+        remove(temp_name);
     }
 
     return deleted;
 }
 
+// Delete data for JSON files
+bool delete_data_json(const char* filename, const char* key) {
+    return delete_lines(filename, key);
+}
+
 // Delete data for XML files
 bool delete_data_xml(const char* filename, const char* key) {
-    FILE* file = fopen(filename, "r");
-    if (!file) {
+    return delete_lines(filename, key);
+}
+
+// Delete data for many keys at once
+bool delete_data_batch(const char* filename, const char* const* keys, int num_keys, int* num_deleted) {
+    int deleted = 0;
+    for (int k = 0; k < num_keys; k++) deleted += delete_data(filename, keys[k]);
+    if (num_deleted) *num_deleted = deleted;
+    return deleted > 0;
+}
+#endif
+#pragma endregion
+
+
+#pragma region handles
+#ifndef _WIN32
+#define DELETED_MEMBER ((size_t)-1)
+
+// One top-level member, by offsets into the mapping (whose address changes when the file grows or shrinks)
+typedef struct {
+    size_t key_at; // DELETED_MEMBER once deleted
+    size_t key_len;
+    size_t value_at; // JSON strings: the text between the quotes
+    size_t value_len;
+} jxsl_member;
+
+struct jxsl_doc {
+    char* filename; // changes that move members write a new version of the file under this name
+    int fd;
+    bool is_json;
+    bool read_only;
+    char* map; // the whole file, shared: edits that fit go straight into the page cache
+    size_t size;
+    jxsl_member* members; // in file order, deleted ones stay as holes
+    size_t member_count;
+    size_t member_capacity;
+    size_t live_count;
+    size_t* slots; // open addressing: member index + 1, 0 for an empty slot
+    size_t slot_count; // power of two, at most half full (counting holes)
+    bool index_failed; // out of memory while scanning
+};
+
+static bool doc_key_equals(const jxsl_doc* doc, const jxsl_member* member, const char* key, size_t key_len) {
+    return member->key_at != DELETED_MEMBER && member->key_len == key_len &&
+           memcmp(doc->map + member->key_at, key, key_len) == 0;
+}
+
+// Slot of the key's member, or the empty slot where it would go
+static size_t doc_find_slot(const jxsl_doc* doc, const char* key, size_t key_len) {
+    size_t mask = doc->slot_count - 1;
+    size_t i = hash_key(key, key_len) & mask;
+    while (doc->slots[i] != 0 && !doc_key_equals(doc, &doc->members[doc->slots[i] - 1], key, key_len)) {
+        i = (i + 1) & mask;
+    }
+    return i;
+}
+
+static jxsl_member* doc_find(const jxsl_doc* doc, const char* key) {
+    if (!doc->map) return NULL;
+    size_t slot = doc_find_slot(doc, key, strlen(key));
+    return doc->slots[slot] ? &doc->members[doc->slots[slot] - 1] : NULL;
+}
+
+static bool doc_grow_slots(jxsl_doc* doc) {
+    size_t count = doc->slot_count ? doc->slot_count * 2 : 16;
+    size_t* slots = calloc(count, sizeof(size_t));
+    if (!slots) {
+        perror("Error allocating memory");
+        return false;
+    }
+    free(doc->slots);
+    doc->slots = slots;
+    doc->slot_count = count;
+    for (size_t m = 0; m < doc->member_count; m++) {
+        const jxsl_member* member = &doc->members[m];
+        if (member->key_at != DELETED_MEMBER) {
+            slots[doc_find_slot(doc, doc->map + member->key_at, member->key_len)] = m + 1;
+        }
+    }
+    return true;
+}
+
+static bool doc_add_member(jxsl_doc* doc, size_t key_at, size_t key_len, size_t value_at, size_t value_len) {
+    if (2 * (doc->member_count + 1) > doc->slot_count && !doc_grow_slots(doc)) return false;
+    size_t slot = doc_find_slot(doc, doc->map + key_at, key_len);
+    if (doc->slots[slot]) return true; // a key that appears twice: the first one counts
+    if (doc->member_count == doc->member_capacity) {
+        size_t capacity = doc->member_capacity ? doc->member_capacity * 2 : 64;
+        jxsl_member* members = realloc(doc->members, capacity * sizeof(jxsl_member));
+        if (!members) {
+            perror("Error allocating memory");
+            return false;
+        }
+        doc->members = members;
+        doc->member_capacity = capacity;
+    }
+    jxsl_member* member = &doc->members[doc->member_count++];
+    member->key_at = key_at;
+    member->key_len = key_len;
+    member->value_at = value_at;
+    member->value_len = value_len;
+    doc->slots[slot] = doc->member_count;
+    doc->live_count++;
+    return true;
+}
+
+static bool doc_visit(void* context, const char* key, size_t key_len, size_t value_at, size_t value_len) {
+    jxsl_doc* doc = context;
+    doc->index_failed = !doc_add_member(doc, (size_t)(key - doc->map), key_len, value_at, value_len);
+    return !doc->index_failed;
+}
+
+// The members at or behind 'from' moved by 'delta' bytes
+static void doc_move(jxsl_doc* doc, size_t from, ptrdiff_t delta) {
+    for (size_t m = 0; m < doc->member_count; m++) {
+        jxsl_member* member = &doc->members[m];
+        if (member->key_at == DELETED_MEMBER || member->key_at < from) continue;
+        member->key_at = (size_t)((ptrdiff_t)member->key_at + delta);
+        member->value_at = (size_t)((ptrdiff_t)member->value_at + delta);
+    }
+}
+
+jxsl_doc* jxsl_open(const char* filename, int flags) {
+    bool read_only = (flags & JXSL_OPEN_READ_ONLY) != 0;
+    bool is_json = strstr(filename, ".json") != NULL;
+    int fd = open(filename, read_only ? O_RDONLY : O_RDWR);
+    if (fd < 0 && (flags & JXSL_OPEN_CREATE) && access(filename, F_OK) != 0 &&
+        create_file(filename, is_json ? "JSON" : "XML")) {
+        fd = open(filename, read_only ? O_RDONLY : O_RDWR);
+    }
+    if (fd < 0) {
         perror("Error opening file");
+        return NULL;
+    }
+
+    jxsl_doc* doc = calloc(1, sizeof(jxsl_doc));
+    size_t name_len = strlen(filename);
+    char* name = malloc(name_len + 1);
+    struct stat info;
+    if (!doc || !name || fstat(fd, &info) != 0) {
+        free(doc);
+        free(name);
+        close(fd);
+        return NULL;
+    }
+    memcpy(name, filename, name_len + 1);
+    doc->filename = name;
+    doc->fd = fd;
+    doc->is_json = is_json;
+    doc->read_only = read_only;
+    doc->size = (size_t)info.st_size;
+    if (doc->size > 0) {
+        char* map = mmap(NULL, doc->size, PROT_READ | (read_only ? 0 : PROT_WRITE), MAP_SHARED, fd, 0);
+        if (map == MAP_FAILED) {
+            perror("Error mapping file");
+            jxsl_close(doc);
+            return NULL;
+        }
+        doc->map = map;
+    }
+    if (!doc_grow_slots(doc)) {
+        jxsl_close(doc);
+        return NULL;
+    }
+
+    // one scan builds the index; every later call is a lookup in it
+    scan_members(doc->map, doc->size, is_json, doc_visit, doc);
+    if (doc->index_failed) {
+        jxsl_close(doc);
+        return NULL;
+    }
+    return doc;
+}
+
+bool jxsl_read(jxsl_doc* doc, const char* key, char* value) {
+    const jxsl_member* member = doc ? doc_find(doc, key) : NULL;
+    if (!member) return false; // Key not found
+    memcpy(value, doc->map + member->value_at, member->value_len);
+    value[member->value_len] = '\0';
+    return true;
+}
+
+bool jxsl_add(jxsl_doc* doc, const char* key, const char* value) {
+    if (!doc || doc->read_only || !doc->map) return false;
+    if (doc_find(doc, key)) {
+        fprintf(stderr, "Error: Key already exists: %s\n", key);
         return false;
     }
 
-    FILE* temp_file = fopen("temp.xml", "w");
-    if (!temp_file) {
-        fclose(file);
-        perror("Error opening temporary file");
+    // The new member goes behind the last one: in front of the whitespace before the closing brace or root end tag
+    size_t close = doc->size;
+    if (doc->is_json) {
+        while (close > 0 && doc->map[close - 1] != '}') close--;
+        close = close > 0 ? close - 1 : doc->size;
+    } else {
+        while (close > 1 && (doc->map[close - 2] != '<' || doc->map[close - 1] != '/')) close--;
+        close = close > 1 ? close - 2 : doc->size;
+    }
+    if (close == doc->size) {
+        fprintf(stderr, "Error: Malformed document\n");
         return false;
     }
+    size_t at = close;
+    while (at > 0 && isspace((unsigned char)doc->map[at - 1])) at--;
 
-    char line[1024];
-    bool deleted = false;
+    size_t key_len = strlen(key);
+    size_t value_len = strlen(value);
+    char* text = malloc(2 * key_len + value_len + 32);
+    if (!text) {
+        perror("Error allocating memory");
+        return false;
+    }
+    int key_offset, value_offset, length;
+    if (doc->is_json) {
+        length = sprintf(text, "%s\n    \"%n%s\": \"%n%s\"%s", doc->live_count > 0 ? "," : "", &key_offset, key,
+                         &value_offset, value, at == close ? "\n" : "");
+    } else {
+        length = sprintf(text, "\n    <%n%s>%n%s</%s>%s", &key_offset, key, &value_offset, value, key,
+                         at == close ? "\n" : "");
+    }
 
-    while (fgets(line, sizeof(line), file)) {
-        if (!strstr(line, key)) {
-            fputs(line, temp_file); // Copy lines not containing the key
-        } else {
-            deleted = true; // Skip the line containing the key
-        }
+    // Only the closing part of the file moves, in a new version of the file that replaces this one
+    bool added = replace_file(doc->filename, &doc->fd, &doc->map, &doc->size, NULL, 0, at, text, (size_t)length);
+    if (added) {
+        doc_move(doc, at, (ptrdiff_t)length);
+        added = doc_add_member(doc, at + (size_t)key_offset, key_len, at + (size_t)value_offset, value_len);
     }
+    free(text);
+    return added;
+}
 
-    fclose(file);
-    fclose(temp_file);
+bool jxsl_edit(jxsl_doc* doc, const char* key, const char* new_value) {
+    if (!doc || doc->read_only) return false;
+    jxsl_member* member = doc_find(doc, key);
+    if (!member) return false; // Key not found
+    char* map = doc->map;
+    size_t at = member->value_at;
+    size_t old_len = member->value_len;
+    size_t new_len = strlen(new_value);
+    if (!doc->is_json && old_len == 0 && map[at - 2] == '/') {
+        fprintf(stderr, "Error: Cannot edit self-closing element: %s\n", key);
+        return false;
+    }
 
-    // Replace original file with the temporary file
-    if (deleted) {
-        remove(filename);
-        rename("temp.xml", filename);
+    if (new_len > old_len) {
+        // Longer: written to a new version of the file, in which only the members behind the value moved
+        ByteRange old_range = {at, at + old_len};
+        if (!replace_file(doc->filename, &doc->fd, &doc->map, &doc->size, &old_range, 1, at, new_value, new_len)) {
+            return false;
+        }
+        doc_move(doc, at + old_len, (ptrdiff_t)(new_len - old_len));
     } else {
-        remove("temp.xml");
+        // Fits: the rest of the old value becomes whitespace behind the closing quote or end tag
+        size_t closing = 0; // bytes that close the value and move up with it
+        if (!doc->is_json) {
+            closing = member->key_len + 3;
+            memmove(map + at + new_len, map + at + old_len, closing);
+        } else if (map[at - 1] == '"' && map[at + old_len] == '"') {
+            closing = 1;
+            map[at + new_len] = '"';
+        }
+        memcpy(map + at, new_value, new_len);
+        memset(map + at + new_len + closing, ' ', old_len - new_len);
     }
+    member->value_len = new_len;
+    return true;
+}
 
-    return deleted;
+bool jxsl_delete(jxsl_doc* doc, const char* key) {
+    if (!doc || doc->read_only) return false;
+    jxsl_member* member = doc_find(doc, key);
+    if (!member) return false; // Key not found
+
+    size_t begin, end;
+    member_range(doc->map, doc->size, doc->is_json, member->key_at, member->key_len, member->value_at,
+                 member->value_len, &begin, &end);
+    ByteRange range = {begin, end};
+    if (!replace_file(doc->filename, &doc->fd, &doc->map, &doc->size, &range, 1, 0, NULL, 0)) return false;
+    member->key_at = DELETED_MEMBER; // stays in its slot, so probes for other keys still pass it
+    doc->live_count--;
+    doc_move(doc, end, -(ptrdiff_t)(end - begin));
+    return true;
+}
+
+bool jxsl_list_keys(jxsl_doc* doc, key_list* keys) {
+    KeyListBuild build;
+    key_list_start(&build, keys);
+    if (!doc) return false;
+    for (size_t m = 0; m < doc->member_count; m++) {
+        const jxsl_member* member = &doc->members[m];
+        if (member->key_at != DELETED_MEMBER && !key_list_add(&build, doc->map + member->key_at, member->key_len)) break;
+    }
+    return key_list_finish(&build);
+}
+
+bool jxsl_find_keys(jxsl_doc* doc, char** keys, int* num_keys) {
+    key_list list;
+    if (!jxsl_list_keys(doc, &list)) return false;
+    bool copied = copy_keys(&list, keys, num_keys);
+    free_key_list(&list);
+    return copied;
+}
+
+void jxsl_close(jxsl_doc* doc) {
+    if (!doc) return;
+    if (doc->map) munmap(doc->map, doc->size);
+    close(doc->fd);
+    free(doc->filename);
+    free(doc->members);
+    free(doc->slots);
+    free(doc);
+}
+#else
+jxsl_doc* jxsl_open(const char* filename, int flags) {
+    (void)flags;
+    fprintf(stderr, "Error: Document handles are not supported on this platform: %s\n", filename);
+    return NULL;
+}
+
+bool jxsl_read(jxsl_doc* doc, const char* key, char* value) {
+    (void)doc, (void)key, (void)value;
+    return false;
+}
+
+bool jxsl_add(jxsl_doc* doc, const char* key, const char* value) {
+    (void)doc, (void)key, (void)value;
+    return false;
+}
+
+bool jxsl_edit(jxsl_doc* doc, const char* key, const char* new_value) {
+    (void)doc, (void)key, (void)new_value;
+    return false;
+}
+
+bool jxsl_delete(jxsl_doc* doc, const char* key) {
+    (void)doc, (void)key;
+    return false;
+}
+
+bool jxsl_list_keys(jxsl_doc* doc, key_list* keys) {
+    (void)doc;
+    memset(keys, 0, sizeof(*keys));
+    return false;
+}
+
+bool jxsl_find_keys(jxsl_doc* doc, char** keys, int* num_keys) {
+    (void)doc, (void)keys, (void)num_keys;
+    return false;
+}
+
+void jxsl_close(jxsl_doc* doc) {
+    (void)doc;
 }
+#endif
 #pragma endregion
 
@@ -4,11 +4,26 @@
 #define JXSL_LIB_H
 
 #include <stdbool.h>
+#include <stddef.h>
 
 // create file JSON/XML
 bool create_file(const char* filename, const char* format);
 
-// find all keys
+// All top-level keys of a document in file order, in a single allocation: key i is the NUL-terminated string at
+// text + offsets[i]. Released with one call to free_key_list()
+typedef struct {
+    char* text;
+    size_t* offsets; // inside the same allocation as text
+    size_t count;
+} key_list;
+
+// list all keys, however many there are
+bool list_keys(const char* filename, key_list* keys);
+
+void free_key_list(key_list* keys);
+
+// find all keys: a copy of each in keys[], to be freed by the caller. Fails, with the number of keys in *num_keys,
+// if there are more than *num_keys
 bool find_keys(const char* filename, char** keys, int* num_keys);
 
 // read data by key
@@ -27,16 +42,50 @@ bool add_data_json(const char* filename, const char* key_chain, const char* valu
 
 bool add_data_xml(const char* filename, const char* key, const char* value);
 
+// a new value that fits where the old one is written in place (padded with whitespace); a longer one moves the members
+// behind it, which is done in a new version of the file renamed over the old one: readers that have the old file open
+// or mapped keep seeing it whole
 bool edit_data(const char* filename, const char* key, const char* new_value);
 
 bool edit_data_json(const char* filename, const char* key, const char* new_value);
 
 bool edit_data_xml(const char* filename, const char* key, const char* new_value);
 
+// the members that stay are written to a new version of the file, renamed over the old one like by edit_data
 bool delete_data(const char* filename, const char* key);
 
 bool delete_data_json(const char* filename, const char* key);
 
 bool delete_data_xml(const char* filename, const char* key);
 
+// delete the members of many keys in one pass over the file; *num_deleted (if not NULL) receives how many were removed
+bool delete_data_batch(const char* filename, const char* const* keys, int num_keys, int* num_deleted);
+
+// Handle-based API: the document stays open between calls (file descriptor, shared mapping and an in-memory index of
+// the top-level members), so an operation costs a hash lookup instead of reopening and rescanning the file. Changes
+// that move members replace the file like edit_data does, and the handle follows it to the new version.
+// A handle must not be used from several threads at once
+typedef struct jxsl_doc jxsl_doc;
+
+#define JXSL_OPEN_READ_ONLY 0x1 // map the file read-only; every change fails
+#define JXSL_OPEN_CREATE 0x2 // create an empty document (format by extension) if the file does not exist
+
+// open a document; NULL on failure
+jxsl_doc* jxsl_open(const char* filename, int flags);
+
+bool jxsl_read(jxsl_doc* doc, const char* key, char* value);
+
+bool jxsl_add(jxsl_doc* doc, const char* key, const char* value);
+
+bool jxsl_edit(jxsl_doc* doc, const char* key, const char* new_value);
+
+bool jxsl_delete(jxsl_doc* doc, const char* key);
+
+bool jxsl_list_keys(jxsl_doc* doc, key_list* keys);
+
+bool jxsl_find_keys(jxsl_doc* doc, char** keys, int* num_keys);
+
+// close the document and free the handle
+void jxsl_close(jxsl_doc* doc);
+
 #endif
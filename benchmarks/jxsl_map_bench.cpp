@@ -0,0 +1,104 @@
+// Benchmark of the key-value table behind JXSL::data (ns per operation): node-based std::unordered_map vs. the
+// open-addressing FlatHashMap, both keyed by SourceString views into one key buffer as after a zero-copy load.
+
+#include "jxsl_flat_map.h"
+#include "jxsl_source_string.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <numeric>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Function declarations
+std::string makeKeys(size_t count, std::vector<SourceString>& keys, const char* prefix);
+template <typename Fn>
+void report(const std::string& name, size_t operations, Fn&& run, int rounds);
+template <typename Map>
+void benchmarkMap(const std::string& label, const std::vector<SourceString>& keys, const std::vector<SourceString>& misses,
+                  const std::vector<uint32_t>& order, int rounds);
+
+int main(int argc, char* argv[]) {
+    const size_t maxKeys = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 10000000;
+    const int rounds = argc > 2 ? std::atoi(argv[2]) : 3;
+
+    for (const size_t count : {size_t(10000), size_t(1000000), size_t(10000000)}) {
+        if (count > maxKeys) break;
+        std::vector<SourceString> keys;
+        std::vector<SourceString> misses;
+        const std::string keyText = makeKeys(count, keys, "key");
+        const std::string missText = makeKeys(count, misses, "absent");
+        std::vector<uint32_t> order(count); // lookups in random order, as readData calls would come
+        std::iota(order.begin(), order.end(), 0);
+        std::shuffle(order.begin(), order.end(), std::mt19937(42));
+
+        std::cout << count << " keys, best of " << rounds << " rounds\n";
+        benchmarkMap<std::unordered_map<SourceString, uint32_t, SourceStringHash>>("unordered_map", keys, misses, order, rounds);
+        benchmarkMap<FlatHashMap<SourceString, uint32_t, SourceStringHash>>("flat map", keys, misses, order, rounds);
+        std::cout << "\n";
+    }
+    return 0;
+}
+
+std::string makeKeys(const size_t count, std::vector<SourceString>& keys, const char* prefix) {
+    std::string text;
+    std::vector<size_t> offsets;
+    offsets.reserve(count + 1);
+    for (size_t i = 0; i < count; ++i) {
+        offsets.push_back(text.size());
+        text += prefix;
+        text += '_';
+        text += std::to_string(i * 2654435761u % 1000000007u); // scattered, config-like names
+    }
+    offsets.push_back(text.size());
+    keys.reserve(count);
+    for (size_t i = 0; i < count; ++i) {
+        keys.emplace_back(std::string_view(text).substr(offsets[i], offsets[i + 1] - offsets[i]));
+    }
+    return text; // the buffer of a std::string survives the move, so the views stay valid
+}
+
+template <typename Map>
+void benchmarkMap(const std::string& label, const std::vector<SourceString>& keys, const std::vector<SourceString>& misses,
+                  const std::vector<uint32_t>& order, const int rounds) {
+    Map map;
+    report(label + " insert", keys.size(), [&]() {
+        map.clear();
+        for (uint32_t i = 0; i < keys.size(); ++i) map.try_emplace(SourceString(keys[i]), i);
+        return map.size();
+    }, rounds);
+    report(label + " lookup hit", keys.size(), [&]() {
+        size_t sum = 0;
+        for (const uint32_t i : order) sum += map.find(keys[i])->second;
+        return sum;
+    }, rounds);
+    report(label + " lookup miss", misses.size(), [&]() {
+        size_t found = 0;
+        for (const SourceString& key : misses) found += map.find(key) != map.end();
+        return found;
+    }, rounds);
+    report(label + " iterate", keys.size(), [&]() {
+        size_t bytes = 0;
+        for (const auto& [key, value] : map) bytes += key.size() + value;
+        return bytes;
+    }, rounds);
+}
+
+template <typename Fn>
+void report(const std::string& name, const size_t operations, Fn&& run, const int rounds) {
+    double best = 0.0;
+    size_t result = 0;
+    for (int round = 0; round < rounds; ++round) {
+        const auto start = std::chrono::steady_clock::now();
+        result = run();
+        const std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+        const double perOperation = elapsed.count() / static_cast<double>(operations);
+        best = round == 0 ? perOperation : std::min(best, perOperation);
+    }
+    std::cout << std::left << std::setw(28) << name << std::right << std::setw(10) << std::fixed
+              << std::setprecision(1) << best << " ns/op  (" << result << ")\n";
+}
@@ -0,0 +1,170 @@
+// Benchmark of parsing throughput (MB/s): the original getline-based JXSL::parseJson/parseXml vs. the stages of the
+// current load path (structural index or tokenizer, document tree) and a whole JXSL load from a file.
+
+#include "jxsl_lib_cpp.h"
+#include "jxsl_document.h"
+#include "jxsl_json_index.h"
+#include "jxsl_xml_tokenizer.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+
+// Function declarations
+std::string makeDocument(size_t targetBytes);
+std::string makeXmlDocument(size_t targetBytes);
+void legacyParseJson(const std::string& content, std::unordered_map<std::string, std::string>& data);
+size_t loadFile(const std::string& filename);
+void legacyParseXml(const std::string& content, std::unordered_map<std::string, std::string>& data);
+template <typename Fn>
+void report(const std::string& name, const std::string& content, Fn&& parse, int rounds);
+
+int main(int argc, char* argv[]) {
+    const size_t megabytes = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 64;
+    const int rounds = argc > 2 ? std::atoi(argv[2]) : 5;
+    const std::string content = makeDocument(megabytes << 20);
+
+    std::cout << "JSON document: " << content.size() / (1 << 20) << " MB, best of " << rounds << " rounds\n";
+    report("legacy getline parser", content, [](const std::string& text) {
+        std::unordered_map<std::string, std::string> data;
+        legacyParseJson(text, data);
+        return data.size();
+    }, rounds);
+    report("structural index only", content, [](const std::string& text) {
+        JsonIndex index;
+        index.build(text);
+        return index.positions().size();
+    }, rounds);
+    report("document tree", content, [](const std::string& text) {
+        Document document;
+        document.parseJson(text);
+        return document.root()->childCount;
+    }, rounds);
+    const std::string jsonFile = "jxsl_parse_bench.json";
+    std::ofstream(jsonFile, std::ios::binary) << content;
+    report("JXSL load (map + tree)", content, [&jsonFile](const std::string&) { return loadFile(jsonFile); }, rounds);
+    std::remove(jsonFile.c_str());
+
+    const std::string xml = makeXmlDocument(megabytes << 20);
+    std::cout << "XML document: " << xml.size() / (1 << 20) << " MB, best of " << rounds << " rounds\n";
+    report("legacy getline parser", xml, [](const std::string& text) {
+        std::unordered_map<std::string, std::string> data;
+        legacyParseXml(text, data);
+        return data.size();
+    }, rounds);
+    report("tokenizer only", xml, [](const std::string& text) { // the scan behind the lazy load mode
+        XmlTokenizer tokenizer(text);
+        std::string_view tag;
+        std::string_view value;
+        size_t elements = 0;
+        while (tokenizer.nextElement(tag, value)) ++elements;
+        return elements;
+    }, rounds);
+    report("document tree", xml, [](const std::string& text) {
+        Document document;
+        document.parseXml(text);
+        return document.root()->childCount;
+    }, rounds);
+    const std::string xmlFile = "jxsl_parse_bench.xml";
+    std::ofstream(xmlFile, std::ios::binary) << xml;
+    report("JXSL load (map + tree)", xml, [&xmlFile](const std::string&) { return loadFile(xmlFile); }, rounds);
+    std::remove(xmlFile.c_str());
+    return 0;
+}
+
+// Flat object in the layout JXSL writes, with a few escapes to exercise the escape handling
+std::string makeDocument(const size_t targetBytes) {
+    std::string json = "{\n";
+    for (size_t i = 0; json.size() < targetBytes; ++i) {
+        if (i > 0) json += ",\n";
+        json += "    \"key" + std::to_string(i) + "\": \"value " + std::to_string(i * 7919);
+        json += (i % 16 == 0) ? " with \\\"escaped\\\" text\"" : "\"";
+    }
+    json += "\n}";
+    return json;
+}
+
+// Root element with one child per entry, in the layout JXSL writes
+std::string makeXmlDocument(const size_t targetBytes) {
+    std::string xml = "<root>\n";
+    for (size_t i = 0; xml.size() < targetBytes; ++i) {
+        const std::string key = "key" + std::to_string(i);
+        xml += "    <" + key + ">value " + std::to_string(i * 7919) + "</" + key + ">\n";
+    }
+    xml += "</root>";
+    return xml;
+}
+
+// JXSL::parseJson before the structural index, kept as the baseline
+void legacyParseJson(const std::string& content, std::unordered_map<std::string, std::string>& data) {
+    const auto trimQuotes = [](std::string& str) {
+        str.erase(std::remove(str.begin(), str.end(), '"'), str.end());
+        str.erase(0, str.find_first_not_of(" \t\n"));
+        str.erase(str.find_last_not_of(" \t\n") + 1);
+    };
+
+    data.clear();
+    const size_t start = content.find('{');
+    const size_t end = content.find('}');
+    if (start == std::string::npos || end == std::string::npos) return;
+
+    std::string body = content.substr(start + 1, end - start - 1);
+    std::istringstream ss(body);
+    std::string line;
+    while (std::getline(ss, line, ',')) {
+        const size_t colon = line.find(':');
+        if (colon != std::string::npos) {
+            std::string key = line.substr(0, colon);
+            std::string value = line.substr(colon + 1);
+            trimQuotes(key);
+            trimQuotes(value);
+            data[key] = value;
+        }
+    }
+}
+
+// the constructor maps the file, parses it into the tree and fills the entry table with views into the mapping
+size_t loadFile(const std::string& filename) {
+    JXSL handler(filename);
+    return handler.documentRoot()->childCount;
+}
+
+// JXSL::parseXml before the tokenizer, kept as the baseline
+void legacyParseXml(const std::string& content, std::unordered_map<std::string, std::string>& data) {
+    data.clear();
+    const size_t start = content.find("<root>");
+    const size_t end = content.find("</root>");
+    if (start == std::string::npos || end == std::string::npos) return;
+
+    std::string body = content.substr(start + 6, end - start - 6);
+    std::istringstream ss(body);
+    std::string line;
+    while (std::getline(ss, line, '>')) {
+        const size_t closeTag = line.find('<');
+        if (closeTag != std::string::npos) {
+            std::string key = line.substr(0, closeTag);
+            std::string value = line.substr(key.length() + 1);
+            data[key] = value;
+        }
+    }
+}
+
+template <typename Fn>
+void report(const std::string& name, const std::string& content, Fn&& parse, const int rounds) {
+    double best = 0.0;
+    size_t result = 0;
+    for (int round = 0; round < rounds; ++round) {
+        const auto start = std::chrono::steady_clock::now();
+        result = parse(content);
+        const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        best = std::max(best, static_cast<double>(content.size()) / (1 << 20) / elapsed.count());
+    }
+    std::cout << std::left << std::setw(28) << name << std::right << std::setw(10) << std::fixed
+              << std::setprecision(1) << best << " MB/s  (" << result << " items)\n";
+}
@@ -0,0 +1,278 @@
+// JSON/XML Simple Library (JXSL). Asynchronous file I/O: io_uring set up with raw syscalls (no liburing), one reaper
+// thread per ring turning completions into futures.
+#include "jxsl_async_io.h"
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <iostream>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define JXSL_POSIX_IO 1
+#include <unistd.h>
+#endif
+
+#if defined(__linux__) && __has_include(<linux/io_uring.h>)
+#define JXSL_IO_URING 1
+#include <cstring>
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#endif
+
+namespace {
+
+#ifdef JXSL_IO_URING
+template <typename T>
+T* at(void* base, const uint32_t offset) {
+    return reinterpret_cast<T*>(static_cast<char*>(base) + offset);
+}
+#endif
+
+} // namespace
+
+AsyncIo::AsyncIo(const unsigned queueDepth) {
+#ifdef JXSL_IO_URING
+    io_uring_params params{};
+    const long fd = syscall(__NR_io_uring_setup, std::max(queueDepth, 1u), &params);
+    if (fd < 0) return; // synchronous fallback
+    ringFd = static_cast<int>(fd);
+
+    sqRingSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    cqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    const bool single = params.features & IORING_FEAT_SINGLE_MMAP; // both rings in one mapping (5.4+)
+    if (single) sqRingSize = cqRingSize = std::max(sqRingSize, cqRingSize);
+    sqEntriesSize = params.sq_entries * sizeof(io_uring_sqe);
+
+    sqRing = mmap(nullptr, sqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd, IORING_OFF_SQ_RING);
+    cqRing = single || sqRing == MAP_FAILED
+                 ? sqRing
+                 : mmap(nullptr, cqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd, IORING_OFF_CQ_RING);
+    sqEntries = mmap(nullptr, sqEntriesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd, IORING_OFF_SQES);
+    if (sqRing == MAP_FAILED || cqRing == MAP_FAILED || sqEntries == MAP_FAILED) {
+        unmap();
+        return;
+    }
+    sqTail = at<unsigned>(sqRing, params.sq_off.tail);
+    sqArray = at<unsigned>(sqRing, params.sq_off.array);
+    sqMask = *at<unsigned>(sqRing, params.sq_off.ring_mask);
+    sqCapacity = params.sq_entries;
+    cqHead = at<unsigned>(cqRing, params.cq_off.head);
+    cqTail = at<unsigned>(cqRing, params.cq_off.tail);
+    cqMask = *at<unsigned>(cqRing, params.cq_off.ring_mask);
+    cqCapacity = params.cq_entries;
+    cqEntries = at<io_uring_cqe>(cqRing, params.cq_off.cqes);
+
+    reaper = std::thread(&AsyncIo::reap, this);
+#else
+    (void)queueDepth;
+#endif
+}
+
+AsyncIo::~AsyncIo() {
+    if (ringFd < 0) return;
+    bool woken = true;
+    if (!broken) {
+        queue(Op::Stop, -1, nullptr, 0, 0); // a no-op that wakes the reaper; it leaves once nothing is in flight
+        std::unique_lock<std::mutex> lock(mutex);
+        stopping = true;
+        woken = submitLocked(lock) || inFlight > 0;
+    }
+    if (!woken) {
+        // nothing can complete any more, so the reaper stays blocked in the kernel: it keeps the ring, which is leaked
+        std::cerr << "Error: io_uring reaper cannot be stopped\n";
+        reaper.detach();
+        return;
+    }
+    reaper.join();
+    unmap();
+}
+
+void AsyncIo::unmap() {
+#ifdef JXSL_IO_URING
+    if (sqEntries && sqEntries != MAP_FAILED) munmap(sqEntries, sqEntriesSize);
+    if (cqRing && cqRing != MAP_FAILED && cqRing != sqRing) munmap(cqRing, cqRingSize);
+    if (sqRing && sqRing != MAP_FAILED) munmap(sqRing, sqRingSize);
+    sqRing = cqRing = sqEntries = nullptr;
+    ::close(ringFd);
+    ringFd = -1;
+#endif
+}
+
+std::future<int64_t> AsyncIo::read(const int fd, char* buffer, const size_t size, const uint64_t offset) {
+    return queue(Op::Read, fd, buffer, size, offset);
+}
+
+std::future<int64_t> AsyncIo::write(const int fd, const char* data, const size_t size, const uint64_t offset) {
+    return queue(Op::Write, fd, const_cast<char*>(data), size, offset); // only read from
+}
+
+std::future<int64_t> AsyncIo::dataSync(const int fd) {
+    return queue(Op::DataSync, fd, nullptr, 0, 0);
+}
+
+std::future<int64_t> AsyncIo::queue(const Op op, const int fd, char* buffer, const size_t size, const uint64_t offset) {
+#ifdef JXSL_IO_URING
+    if (usingRing()) {
+        std::unique_lock<std::mutex> lock(mutex);
+        // every submitted request needs a completion slot: the completion queue must never overflow
+        while (!broken && (queued == sqCapacity || inFlight + queued >= cqCapacity)) {
+            if (queued > 0) {
+                submitLocked(lock); // a failed submission fails the queued requests, which makes room as well
+            } else {
+                space.wait(lock);
+            }
+        }
+        if (!broken) {
+            auto* request = new Request; // handed to the reaper through the mutex, which the kernel's ordering does not show
+            std::future<int64_t> result = request->done.get_future();
+            const unsigned tail = *sqTail; // only written under the mutex
+            const unsigned index = tail & sqMask;
+            io_uring_sqe& entry = static_cast<io_uring_sqe*>(sqEntries)[index];
+            std::memset(&entry, 0, sizeof(entry));
+            entry.fd = fd;
+            entry.off = offset;
+            entry.addr = reinterpret_cast<uint64_t>(buffer);
+            entry.len = static_cast<uint32_t>(size);
+            entry.user_data = reinterpret_cast<uint64_t>(request);
+            switch (op) {
+            case Op::Read:
+                entry.opcode = IORING_OP_READ;
+                break;
+            case Op::Write:
+                entry.opcode = IORING_OP_WRITE;
+                break;
+            case Op::DataSync:
+                entry.opcode = IORING_OP_FSYNC;
+                entry.fsync_flags = IORING_FSYNC_DATASYNC;
+                break;
+            case Op::Stop:
+                entry.opcode = IORING_OP_NOP;
+                break;
+            }
+            sqArray[index] = index;
+            __atomic_store_n(sqTail, tail + 1, __ATOMIC_RELEASE); // the entry is complete before the kernel can see it
+            ++queued;
+            return result;
+        }
+    }
+#endif
+    std::promise<int64_t> done;
+    done.set_value(runNow(op, fd, buffer, size, offset));
+    return done.get_future();
+}
+
+int64_t AsyncIo::runNow(const Op op, const int fd, char* buffer, const size_t size, const uint64_t offset) {
+    int64_t result = -ENOSYS;
+#ifdef JXSL_POSIX_IO
+    if (op == Op::Read) {
+        result = pread(fd, buffer, size, static_cast<off_t>(offset));
+    } else if (op == Op::Write) {
+        result = pwrite(fd, buffer, size, static_cast<off_t>(offset));
+    } else if (op == Op::DataSync) {
+#ifdef __APPLE__
+        result = fsync(fd);
+#else
+        result = fdatasync(fd);
+#endif
+    }
+    if (result < 0) result = -errno;
+#else
+    (void)op, (void)fd, (void)buffer, (void)size, (void)offset;
+#endif
+    return result;
+}
+
+bool AsyncIo::submit() {
+    if (!usingRing()) return true; // everything ran when it was queued
+    std::unique_lock<std::mutex> lock(mutex);
+    return submitLocked(lock);
+}
+
+bool AsyncIo::submitLocked(std::unique_lock<std::mutex>& lock) {
+#ifdef JXSL_IO_URING
+    while (queued > 0) {
+        const long submitted = syscall(__NR_io_uring_enter, ringFd, queued, 0, 0, nullptr, 0);
+        if (submitted < 0) {
+            const int error = errno;
+            if (error == EINTR) continue;
+            if ((error == EAGAIN || error == EBUSY) && inFlight > 0) {
+                space.wait(lock); // short of resources until completions are reaped
+                continue;
+            }
+            std::cerr << "Error: io_uring submission failed: " << std::strerror(error) << "\n";
+            failQueued(error);
+            return false;
+        }
+        queued -= static_cast<unsigned>(submitted);
+        inFlight += static_cast<unsigned>(submitted);
+    }
+    return !broken; // the reaper may have failed them while this thread waited
+#else
+    (void)lock;
+    return true;
+#endif
+}
+
+void AsyncIo::finish(Request* request, const int64_t result) {
+    request->done.set_value(result);
+    delete request;
+}
+
+void AsyncIo::failQueued(const int error) {
+#ifdef JXSL_IO_URING
+    // the kernel has not seen the entries at the end of the submission queue yet: take them back
+    unsigned tail = *sqTail;
+    for (; queued > 0; --queued) {
+        --tail;
+        const io_uring_sqe& entry = static_cast<io_uring_sqe*>(sqEntries)[tail & sqMask];
+        finish(reinterpret_cast<Request*>(entry.user_data), -error);
+    }
+    __atomic_store_n(sqTail, tail, __ATOMIC_RELEASE);
+    space.notify_all();
+#else
+    (void)error;
+#endif
+}
+
+void AsyncIo::reap() {
+#ifdef JXSL_IO_URING
+    for (;;) {
+        // one syscall waits for any number of completions, from any of the documents sharing the ring
+        if (syscall(__NR_io_uring_enter, ringFd, 0, 1, IORING_ENTER_GETEVENTS, nullptr, 0) < 0 && errno != EINTR) {
+            const int error = errno;
+            std::cerr << "Error: io_uring wait failed, falling back to synchronous I/O: " << std::strerror(error) << "\n";
+            std::unique_lock<std::mutex> lock(mutex);
+            broken = true; // nothing goes to the ring any more
+            failQueued(error); // the kernel has not seen these
+            // the submitted ones may still be reading into or writing from their buffers: they complete only with their
+            // own completions, which the kernel posts to the ring whether or not anyone waits in io_uring_enter
+            while (inFlight > 0) {
+                lock.unlock();
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                lock.lock();
+                completePosted();
+            }
+            space.notify_all();
+            return;
+        }
+        std::lock_guard<std::mutex> lock(mutex);
+        completePosted();
+        if (stopping && inFlight == 0 && queued == 0) return;
+    }
+#endif
+}
+
+void AsyncIo::completePosted() {
+#ifdef JXSL_IO_URING
+    unsigned head = *cqHead; // only the reaper moves the head
+    const unsigned tail = __atomic_load_n(cqTail, __ATOMIC_ACQUIRE);
+    const unsigned completed = tail - head;
+    for (; head != tail; ++head) {
+        const io_uring_cqe& completion = static_cast<io_uring_cqe*>(cqEntries)[head & cqMask];
+        finish(reinterpret_cast<Request*>(completion.user_data), completion.res);
+    }
+    __atomic_store_n(cqHead, tail, __ATOMIC_RELEASE);
+    inFlight -= completed;
+    space.notify_all();
+#endif
+}
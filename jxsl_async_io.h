@@ -0,0 +1,78 @@
+// JSON/XML Simple Library (JXSL). Asynchronous file I/O on a Linux io_uring that many documents can share: operations
+// are queued, handed to the kernel with one io_uring_enter per batch and completed through futures.
+
+#ifndef JXSL_ASYNC_IO_H
+#define JXSL_ASYNC_IO_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <future>
+#include <mutex>
+#include <thread>
+
+// Without io_uring (other systems, old kernels, or a sandbox that forbids it) every operation runs synchronously when
+// it is queued and its future is ready right away. Operations the kernel refuses complete with -errno; once waiting for
+// completions fails, the ring is given up and later operations run synchronously as well. Operations the kernel has
+// already taken still complete only when it is done with their buffers.
+class AsyncIo {
+public:
+    static constexpr size_t CHUNK = 1 << 20; // largest single read or write callers should queue
+
+    explicit AsyncIo(unsigned queueDepth = 256);
+    ~AsyncIo(); // waits for the operations in flight
+    AsyncIo(const AsyncIo&) = delete;
+    AsyncIo& operator=(const AsyncIo&) = delete;
+
+    bool usingRing() const { return ringFd >= 0 && !broken; }
+
+    // results are the bytes transferred (possibly short) or -errno; buffers must stay valid until the future is ready
+    std::future<int64_t> read(int fd, char* buffer, size_t size, uint64_t offset);
+    std::future<int64_t> write(int fd, const char* data, size_t size, uint64_t offset);
+    std::future<int64_t> dataSync(int fd); // fdatasync; not ordered with operations still in flight
+    bool submit(); // hand everything queued so far to the kernel in one syscall; false: they failed with -errno
+
+private:
+    enum class Op : uint8_t { Read, Write, DataSync, Stop };
+    struct Request {
+        std::promise<int64_t> done;
+    };
+
+    int ringFd = -1;
+    void* sqRing = nullptr;
+    void* cqRing = nullptr;
+    void* sqEntries = nullptr; // the submission queue entries
+    size_t sqRingSize = 0;
+    size_t cqRingSize = 0;
+    size_t sqEntriesSize = 0;
+    unsigned* sqTail = nullptr;
+    unsigned* sqArray = nullptr;
+    unsigned sqMask = 0;
+    unsigned sqCapacity = 0;
+    unsigned* cqHead = nullptr;
+    unsigned* cqTail = nullptr;
+    unsigned cqMask = 0;
+    unsigned cqCapacity = 0;
+    void* cqEntries = nullptr;
+
+    std::mutex mutex; // guards the submission queue and the counters
+    std::condition_variable space; // completions make room for more requests
+    unsigned queued = 0; // in the submission queue, not yet submitted
+    unsigned inFlight = 0; // submitted, completion not reaped yet (at most cqCapacity)
+    bool stopping = false;
+    // waiting for completions failed: nothing goes to the ring, the reaper only collects what is in flight and leaves
+    std::atomic<bool> broken = false;
+    std::thread reaper; // waits for completions and fulfils the promises
+
+    std::future<int64_t> queue(Op op, int fd, char* buffer, size_t size, uint64_t offset);
+    static int64_t runNow(Op op, int fd, char* buffer, size_t size, uint64_t offset); // the synchronous fallback
+    bool submitLocked(std::unique_lock<std::mutex>& lock);
+    void finish(Request* request, int64_t result); // fulfils the promise and frees the request
+    void failQueued(int error); // requests not submitted yet
+    void reap();
+    void completePosted(); // fulfils the promises of the completions in the ring so far; mutex held
+    void unmap();
+};
+
+#endif // JXSL_ASYNC_IO_H
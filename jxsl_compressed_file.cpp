@@ -0,0 +1,275 @@
+// JSON/XML Simple Library (JXSL). Block-compressed container: LZ77 codec with LZ4-style sequences (literal run, 16-bit
+// back-reference), per-block Bloom filters and the index that lets a lazy read decompress a single block.
+#include "jxsl_compressed_file.h"
+#include <algorithm>
+#include <array>
+#include <cstring>
+
+namespace {
+
+constexpr char MAGIC[8] = {'J', 'X', 'S', 'L', 'B', 'L', 'K', '1'};
+constexpr size_t HEADER_SIZE = 24; // magic, format, 3 reserved bytes, block count, raw size
+constexpr size_t INDEX_ENTRY = 24; // offset, packed size, raw size, filter size, checksum of filter and packed bytes
+constexpr size_t MIN_MATCH = 4;
+constexpr size_t MAX_OFFSET = 65535;
+constexpr int HASH_BITS = 13;
+constexpr int FILTER_PROBES = 4;
+constexpr size_t FILTER_BITS_PER_KEY = 10; // about 1% false positives
+
+void putU32(char* out, const uint32_t value) {
+    for (int i = 0; i < 4; ++i) out[i] = static_cast<char>(value >> (8 * i));
+}
+
+void putU64(char* out, const uint64_t value) {
+    for (int i = 0; i < 8; ++i) out[i] = static_cast<char>(value >> (8 * i));
+}
+
+uint32_t getU32(const char* in) {
+    uint32_t value = 0;
+    for (int i = 0; i < 4; ++i) value |= static_cast<uint32_t>(static_cast<uint8_t>(in[i])) << (8 * i);
+    return value;
+}
+
+uint64_t getU64(const char* in) {
+    uint64_t value = 0;
+    for (int i = 0; i < 8; ++i) value |= static_cast<uint64_t>(static_cast<uint8_t>(in[i])) << (8 * i);
+    return value;
+}
+
+uint32_t load32(const char* in) {
+    uint32_t value;
+    std::memcpy(&value, in, sizeof(value));
+    return value;
+}
+
+// FNV-1a: the filters are stored in files, so the hash must not depend on the standard library
+uint64_t keyHash(const std::string_view key) {
+    uint64_t hash = 14695981039346656037ull;
+    for (const char c : key) hash = (hash ^ static_cast<uint8_t>(c)) * 1099511628211ull;
+    return hash;
+}
+
+// a damaged filter would hide keys without any other sign, so filter and data are checked together when opened
+uint32_t checksum(const std::string_view bytes) {
+    const uint64_t hash = keyHash(bytes);
+    return static_cast<uint32_t>(hash ^ (hash >> 32));
+}
+
+// double hashing: probe i tests bit (h1 + i * h2) mod bits
+template <typename Visit>
+bool probeFilter(const std::string_view key, const size_t bits, Visit visit) {
+    const uint64_t hash = keyHash(key);
+    const uint64_t step = (hash >> 32) | 1;
+    for (int i = 0; i < FILTER_PROBES; ++i) {
+        if (!visit((hash + static_cast<uint64_t>(i) * step) & (bits - 1))) return false;
+    }
+    return true;
+}
+
+void putLength(std::pmr::string& out, size_t length) { // the part of a length beyond the token's 15
+    for (; length >= 255; length -= 255) out += static_cast<char>(255);
+    out += static_cast<char>(length);
+}
+
+// sequences of (token, literal length, literals, offset, match length); the last one has literals only
+void compress(const std::string_view in, std::pmr::string& out) {
+    std::array<uint32_t, size_t{1} << HASH_BITS> table{}; // position + 1 of the last 4 bytes with that hash
+    const size_t n = in.size();
+    size_t anchor = 0;
+    size_t i = 0;
+    const auto emit = [&](const size_t literals, const size_t offset, const size_t match) {
+        const size_t matchCode = match == 0 ? 0 : match - MIN_MATCH;
+        out += static_cast<char>((std::min<size_t>(literals, 15) << 4) | std::min<size_t>(matchCode, 15));
+        if (literals >= 15) putLength(out, literals - 15);
+        out.append(in.data() + anchor, literals);
+        if (match == 0) return;
+        out += static_cast<char>(offset & 0xFF);
+        out += static_cast<char>(offset >> 8);
+        if (matchCode >= 15) putLength(out, matchCode - 15);
+    };
+    while (i + MIN_MATCH <= n) {
+        const uint32_t word = load32(in.data() + i);
+        const uint32_t slot = (word * 2654435761u) >> (32 - HASH_BITS);
+        const size_t candidate = table[slot];
+        table[slot] = static_cast<uint32_t>(i + 1);
+        if (candidate == 0 || i - (candidate - 1) > MAX_OFFSET || load32(in.data() + candidate - 1) != word) {
+            i += 1 + ((i - anchor) >> 6); // skip faster through text that does not compress
+            continue;
+        }
+        const size_t from = candidate - 1;
+        size_t length = MIN_MATCH;
+        while (i + length < n && in[from + length] == in[i + length]) ++length;
+        emit(i - anchor, i - from, length);
+        i += length;
+        anchor = i;
+    }
+    emit(n - anchor, 0, 0);
+}
+
+bool decompress(const char* in, const size_t size, char* out, const size_t rawSize) {
+    const char* const end = in + size;
+    char* const begin = out;
+    char* const outEnd = out + rawSize;
+    const auto readLength = [&](size_t& length) {
+        uint8_t byte = 255;
+        while (byte == 255) {
+            if (in == end) return false;
+            byte = static_cast<uint8_t>(*in++);
+            length += byte;
+        }
+        return true;
+    };
+    while (in < end) {
+        const auto token = static_cast<uint8_t>(*in++);
+        size_t literals = token >> 4;
+        if (literals == 15 && !readLength(literals)) return false;
+        if (literals > static_cast<size_t>(end - in) || literals > static_cast<size_t>(outEnd - out)) return false;
+        std::memcpy(out, in, literals);
+        in += literals;
+        out += literals;
+        if (in == end) break;
+
+        if (end - in < 2) return false;
+        const size_t offset = static_cast<uint8_t>(in[0]) | static_cast<size_t>(static_cast<uint8_t>(in[1])) << 8;
+        in += 2;
+        size_t match = token & 15;
+        if (match == 15 && !readLength(match)) return false;
+        match += MIN_MATCH;
+        if (offset == 0 || offset > static_cast<size_t>(out - begin) || match > static_cast<size_t>(outEnd - out)) {
+            return false;
+        }
+        const char* from = out - offset;
+        for (size_t k = 0; k < match; ++k) out[k] = from[k]; // byte by byte: the ranges overlap for short offsets
+        out += match;
+    }
+    return out == outEnd;
+}
+
+} // namespace
+
+bool CompressedFile::detect(const std::string_view contents) {
+    return contents.size() >= HEADER_SIZE && std::memcmp(contents.data(), MAGIC, sizeof(MAGIC)) == 0;
+}
+
+void CompressedFile::pack(const std::string_view text, const std::span<const Member> members, const bool isJson,
+                          std::pmr::string& out) {
+    // block boundaries: block i covers [starts[i], starts[i + 1]) and holds keys [firstKey[i], firstKey[i + 1])
+    std::vector<size_t> starts{0};
+    std::vector<size_t> firstKey{0};
+    for (size_t i = 0; i < members.size(); ++i) {
+        if (members[i].at - starts.back() >= BLOCK_SIZE) {
+            starts.push_back(members[i].at);
+            firstKey.push_back(i);
+        }
+    }
+    starts.push_back(text.size());
+    firstKey.push_back(members.size());
+    const size_t count = starts.size() - 1;
+
+    out.clear();
+    out.resize(HEADER_SIZE + count * INDEX_ENTRY);
+    std::memcpy(out.data(), MAGIC, sizeof(MAGIC));
+    out[8] = isJson ? 1 : 0;
+    putU32(out.data() + 12, static_cast<uint32_t>(count));
+    putU64(out.data() + 16, text.size());
+
+    for (size_t b = 0; b < count; ++b) {
+        const size_t offset = out.size();
+        size_t bits = 64;
+        while (bits < (firstKey[b + 1] - firstKey[b]) * FILTER_BITS_PER_KEY) bits *= 2;
+        out.append(bits / 8, '\0');
+        for (size_t k = firstKey[b]; k < firstKey[b + 1]; ++k) {
+            probeFilter(members[k].key, bits, [&](const uint64_t bit) {
+                out[offset + bit / 8] = static_cast<char>(out[offset + bit / 8] | (1 << (bit % 8)));
+                return true;
+            });
+        }
+
+        const std::string_view block = text.substr(starts[b], starts[b + 1] - starts[b]);
+        const size_t packedAt = out.size();
+        compress(block, out);
+        if (out.size() - packedAt >= block.size()) { // no gain: stored as it is
+            out.resize(packedAt);
+            out += block;
+        }
+        char* entry = out.data() + HEADER_SIZE + b * INDEX_ENTRY;
+        putU64(entry, offset);
+        putU32(entry + 8, static_cast<uint32_t>(out.size() - packedAt));
+        putU32(entry + 12, static_cast<uint32_t>(block.size()));
+        putU32(entry + 16, static_cast<uint32_t>(bits / 8));
+        putU32(entry + 20, checksum(std::string_view(out).substr(offset)));
+    }
+}
+
+CompressedFile::CompressedFile(std::pmr::memory_resource* resource) : blocks(resource) {}
+
+bool CompressedFile::open(const std::string_view text) {
+    close();
+    if (!detect(text)) return false;
+    const uint32_t count = getU32(text.data() + 12);
+    if (count == 0 || count > (text.size() - HEADER_SIZE) / INDEX_ENTRY) return false;
+    json = text[8] != 0;
+    raw = getU64(text.data() + 16);
+
+    uint64_t total = 0;
+    blocks.reserve(count);
+    for (uint32_t b = 0; b < count; ++b) {
+        const char* entry = text.data() + HEADER_SIZE + b * INDEX_ENTRY;
+        const Block block{getU64(entry), getU32(entry + 8), getU32(entry + 12), getU32(entry + 16)};
+        const bool filterValid = block.filterBytes >= 8 && (block.filterBytes & (block.filterBytes - 1)) == 0;
+        const bool inside = block.offset <= text.size() &&
+                            text.size() - block.offset >= uint64_t{block.filterBytes} + block.packedSize;
+        if (!filterValid || !inside ||
+            getU32(entry + 20) != checksum(text.substr(block.offset, block.filterBytes + block.packedSize))) {
+            blocks.clear();
+            return false;
+        }
+        total += block.rawSize;
+        blocks.push_back(block);
+    }
+    if (total != raw) {
+        blocks.clear();
+        return false;
+    }
+    contents = text;
+    return true;
+}
+
+void CompressedFile::close() {
+    contents = {};
+    blocks.clear();
+    raw = 0;
+}
+
+bool CompressedFile::mayContain(const size_t block, const std::string_view key) const {
+    const Block& entry = blocks[block];
+    const char* filter = contents.data() + entry.offset;
+    return probeFilter(key, size_t{entry.filterBytes} * 8, [&](const uint64_t bit) {
+        return (static_cast<uint8_t>(filter[bit / 8]) >> (bit % 8) & 1) != 0;
+    });
+}
+
+bool CompressedFile::readBlock(const size_t block, std::pmr::string& out) const {
+    const Block& entry = blocks[block];
+    const char* packed = contents.data() + entry.offset + entry.filterBytes;
+    const size_t at = out.size();
+    if (entry.packedSize == entry.rawSize) {
+        out.append(packed, entry.packedSize);
+        return true;
+    }
+    out.resize(at + entry.rawSize);
+    if (!decompress(packed, entry.packedSize, out.data() + at, entry.rawSize)) {
+        out.resize(at);
+        return false;
+    }
+    return true;
+}
+
+bool CompressedFile::readAll(std::pmr::string& out) const {
+    out.clear();
+    out.reserve(raw);
+    for (size_t b = 0; b < blocks.size(); ++b) {
+        if (!readBlock(b, out)) return false;
+    }
+    return true;
+}
@@ -0,0 +1,59 @@
+// JSON/XML Simple Library (JXSL). Block-compressed container for documents: the text is cut at member boundaries into
+// blocks of about BLOCK_SIZE bytes, each compressed on its own (byte-oriented LZ77), behind an index that gives every
+// block's position and checksum and a Bloom filter of the keys whose members start in it.
+
+#ifndef JXSL_COMPRESSED_FILE_H
+#define JXSL_COMPRESSED_FILE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory_resource>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+class CompressedFile {
+public:
+    static constexpr size_t BLOCK_SIZE = 64 * 1024; // raw bytes per block, exceeded only by a single larger member
+    static constexpr std::string_view EXTENSION = ".jxz"; // files with this suffix are always written compressed
+
+    // a top-level member of the text to pack: where it starts (indentation included) and its key
+    struct Member {
+        size_t at;
+        std::string_view key;
+    };
+
+    static bool detect(std::string_view contents); // starts with the container header
+    // the whole text as a container; blocks are only cut in front of the members, which must be in text order
+    static void pack(std::string_view text, std::span<const Member> members, bool isJson, std::pmr::string& out);
+
+    explicit CompressedFile(std::pmr::memory_resource* resource = std::pmr::get_default_resource());
+
+    // checks the header, the index and the checksum of every block; the contents are not copied and must stay valid
+    // until close()
+    bool open(std::string_view contents);
+    void close();
+    bool isOpen() const { return !contents.empty(); }
+    bool isJson() const { return json; }
+    size_t blockCount() const { return blocks.size(); }
+    size_t rawSize() const { return raw; }
+
+    bool mayContain(size_t block, std::string_view key) const; // false: no member with that key starts in the block
+    bool readBlock(size_t block, std::pmr::string& out) const; // decompressed and appended; false if corrupt
+    bool readAll(std::pmr::string& out) const; // the original text
+
+private:
+    struct Block {
+        uint64_t offset; // of the filter, followed by the compressed bytes
+        uint32_t packedSize; // equal to rawSize: stored uncompressed
+        uint32_t rawSize;
+        uint32_t filterBytes;
+    };
+    std::string_view contents;
+    bool json = false;
+    uint64_t raw = 0;
+    std::pmr::vector<Block> blocks;
+};
+
+#endif // JXSL_COMPRESSED_FILE_H
@@ -0,0 +1,248 @@
+// JSON/XML Simple Library (JXSL). Document tree builders on top of the JSON structural index and the XML tokenizer.
+#include "jxsl_document.h"
+#include "jxsl_json_index.h"
+#include "jxsl_xml_tokenizer.h"
+#include <algorithm>
+#include <cstring>
+
+namespace {
+
+constexpr size_t MAX_BLOCK_SIZE = 16 * 1024 * 1024;
+constexpr int MAX_DEPTH = 1024;
+
+std::string_view trimmed(std::string_view text) {
+    const size_t first = text.find_first_not_of(" \t\r\n");
+    if (first == std::string_view::npos) return {};
+    const size_t last = text.find_last_not_of(" \t\r\n");
+    return text.substr(first, last - first + 1);
+}
+
+bool isDigit(const char c) {
+    return c >= '0' && c <= '9';
+}
+
+// JSON number grammar: -?(0|[1-9][0-9]*)(.[0-9]+)?([eE][+-]?[0-9]+)?
+bool isNumber(const std::string_view literal) {
+    size_t i = 0;
+    const auto digits = [&] {
+        const size_t start = i;
+        while (i < literal.size() && isDigit(literal[i])) ++i;
+        return i > start;
+    };
+    if (i < literal.size() && literal[i] == '-') ++i;
+    if (i < literal.size() && literal[i] == '0') {
+        ++i;
+    } else if (!digits()) {
+        return false;
+    }
+    if (i < literal.size() && literal[i] == '.') {
+        ++i;
+        if (!digits()) return false;
+    }
+    if (i < literal.size() && (literal[i] == 'e' || literal[i] == 'E')) {
+        ++i;
+        if (i < literal.size() && (literal[i] == '+' || literal[i] == '-')) ++i;
+        if (!digits()) return false;
+    }
+    return i == literal.size();
+}
+
+} // namespace
+
+// Arena
+Arena::Arena(const size_t initialBlockSize)
+    : cursor(nullptr), remaining(0), initialBlockSize(initialBlockSize), nextBlockSize(initialBlockSize), reserved(0) {}
+
+void* Arena::allocate(const size_t size, const size_t alignment) {
+    size_t padding = (alignment - reinterpret_cast<uintptr_t>(cursor) % alignment) % alignment;
+    if (padding + size > remaining) {
+        // blocks grow geometrically, so a document needs only a handful of them
+        const size_t blockSize = std::max(nextBlockSize, size + alignment);
+        blocks.push_back(std::make_unique<char[]>(blockSize));
+        cursor = blocks.back().get();
+        remaining = blockSize;
+        reserved += blockSize;
+        nextBlockSize = std::min(nextBlockSize * 2, MAX_BLOCK_SIZE);
+        padding = (alignment - reinterpret_cast<uintptr_t>(cursor) % alignment) % alignment;
+    }
+    void* result = cursor + padding;
+    cursor += padding + size;
+    remaining -= padding + size;
+    return result;
+}
+
+std::string_view Arena::copy(const std::string_view text) {
+    if (text.empty()) return {};
+    char* memory = static_cast<char*>(allocate(text.size(), 1));
+    std::memcpy(memory, text.data(), text.size());
+    return {memory, text.size()};
+}
+
+void Arena::reset() {
+    blocks.clear();
+    cursor = nullptr;
+    remaining = 0;
+    reserved = 0;
+    nextBlockSize = initialBlockSize;
+}
+
+// DocumentNode
+const DocumentNode* DocumentNode::find(const std::string_view name) const {
+    for (const DocumentNode* child = firstChild; child; child = child->next) {
+        if (child->key == name) return child;
+    }
+    return nullptr;
+}
+
+// Document
+void Document::clear() {
+    arena.reset();
+    source = {};
+    rootNode = nullptr;
+}
+
+DocumentNode* Document::newNode(const NodeType type, const std::string_view key) {
+    DocumentNode* node = arena.create<DocumentNode>();
+    node->type = type;
+    node->key = key;
+    return node;
+}
+
+void Document::append(DocumentNode* parent, DocumentNode* child) {
+    if (parent->lastChild) {
+        parent->lastChild->next = child;
+    } else {
+        parent->firstChild = child;
+    }
+    parent->lastChild = child;
+    parent->childCount++;
+}
+
+bool Document::parseJson(const std::string_view json, const bool copyText) {
+    clear();
+    source = copyText ? arena.copy(json) : json;
+
+    JsonIndex index;
+    if (!index.build(source)) return false;
+    size_t i = 0;
+    rootNode = parseJsonValue(index.positions(), i, 0, {}, 0);
+    if (!rootNode) return false;
+    // the root ends at the last structural it consumed; only whitespace may follow it
+    const std::vector<uint32_t>& pos = index.positions();
+    return i == pos.size() && source.find_first_not_of(" \t\r\n", pos[i - 1] + 1) == std::string_view::npos;
+}
+
+// parse the value starting at or after offset 'from'; i is the first structural position not consumed yet
+DocumentNode* Document::parseJsonValue(const std::vector<uint32_t>& pos, size_t& i, const size_t from,
+                                       const std::string_view key, const int depth) {
+    const size_t count = pos.size();
+    if (i >= count || depth > MAX_DEPTH) return nullptr;
+
+    const size_t valueStart = source.find_first_not_of(" \t\r\n", from);
+    const char first = source[pos[i]];
+    if (valueStart != pos[i]) {
+        // number, true, false or null, terminated by the next separator
+        if (first != ',' && first != '}' && first != ']') return nullptr;
+        const std::string_view literal = trimmed(source.substr(from, pos[i] - from));
+        DocumentNode* node;
+        if (literal == "true" || literal == "false") {
+            node = newNode(NodeType::Bool, key);
+            node->boolean = literal == "true";
+        } else if (literal == "null") {
+            node = newNode(NodeType::Null, key);
+        } else if (isNumber(literal)) {
+            node = newNode(NodeType::Number, key);
+        } else {
+            return nullptr;
+        }
+        node->text = literal;
+        return node;
+    }
+
+    if (first == '"') {
+        if (i + 1 >= count || source[pos[i + 1]] != '"') return nullptr;
+        DocumentNode* node = newNode(NodeType::String, key);
+        node->text = source.substr(pos[i] + 1, pos[i + 1] - pos[i] - 1);
+        i += 2;
+        return node;
+    }
+
+    if (first != '{' && first != '[') return nullptr;
+    const bool isObject = first == '{';
+    const char close = isObject ? '}' : ']';
+    DocumentNode* node = newNode(isObject ? NodeType::Object : NodeType::Array, key);
+    const size_t open = pos[i++];
+
+    if (i < count && source[pos[i]] == close) {
+        node->text = source.substr(open, pos[i] - open + 1);
+        ++i;
+        return node;
+    }
+    while (true) {
+        std::string_view memberKey;
+        size_t memberFrom = pos[i - 1] + 1;
+        if (isObject) {
+            if (i + 2 >= count || source[pos[i]] != '"' || source[pos[i + 1]] != '"' || source[pos[i + 2]] != ':') {
+                return nullptr;
+            }
+            memberKey = source.substr(pos[i] + 1, pos[i + 1] - pos[i] - 1);
+            memberFrom = pos[i + 2] + 1;
+            i += 3;
+        }
+        DocumentNode* child = parseJsonValue(pos, i, memberFrom, memberKey, depth + 1);
+        if (!child || i >= count) return nullptr;
+        append(node, child);
+
+        const char separator = source[pos[i]];
+        if (separator == close) break;
+        if (separator != ',') return nullptr;
+        ++i;
+    }
+    node->text = source.substr(open, pos[i] - open + 1);
+    ++i;
+    return node;
+}
+
+bool Document::parseXml(const std::string_view xml, const bool copyText) {
+    clear();
+    source = copyText ? arena.copy(xml) : xml;
+
+    XmlTokenizer tokenizer(source);
+    std::vector<DocumentNode*> stack;
+    std::vector<size_t> contentStart;
+    while (true) {
+        const XmlToken token = tokenizer.next();
+        switch (token.type) {
+            case XmlTokenType::StartTag: {
+                if (stack.empty() && rootNode) { // a second root element
+                    rootNode = nullptr;
+                    return false;
+                }
+                DocumentNode* node = newNode(NodeType::String, token.name);
+                if (stack.empty()) {
+                    rootNode = node;
+                } else {
+                    stack.back()->type = NodeType::Object; // an element with child elements
+                    append(stack.back(), node);
+                }
+                if (!token.selfClosing) {
+                    stack.push_back(node);
+                    contentStart.push_back(token.end);
+                }
+                break;
+            }
+            case XmlTokenType::EndTag:
+                stack.back()->text = source.substr(contentStart.back(), token.begin - contentStart.back());
+                stack.pop_back();
+                contentStart.pop_back();
+                break;
+            case XmlTokenType::Text:
+                break;
+            case XmlTokenType::End:
+                return rootNode != nullptr;
+            case XmlTokenType::Error:
+                rootNode = nullptr;
+                return false;
+        }
+    }
+}
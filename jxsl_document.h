@@ -0,0 +1,74 @@
+// JSON/XML Simple Library (JXSL). Hierarchical document model (objects, arrays, scalars) with nodes bump-allocated from an arena.
+
+#ifndef JXSL_DOCUMENT_H
+#define JXSL_DOCUMENT_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <string_view>
+#include <vector>
+
+// bump allocator: memory is handed out from large blocks and released all at once
+class Arena {
+public:
+    explicit Arena(size_t initialBlockSize = 64 * 1024);
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+
+    void* allocate(size_t size, size_t alignment = alignof(std::max_align_t));
+    template <typename T>
+    T* create() { return new (allocate(sizeof(T), alignof(T))) T(); } // T must be trivially destructible
+    std::string_view copy(std::string_view text);
+    void reset(); // release all blocks at once
+    size_t bytesReserved() const { return reserved; }
+
+private:
+    std::vector<std::unique_ptr<char[]>> blocks;
+    char* cursor;
+    size_t remaining;
+    size_t initialBlockSize;
+    size_t nextBlockSize;
+    size_t reserved;
+};
+
+enum class NodeType { Object, Array, String, Number, Bool, Null };
+
+struct DocumentNode {
+    NodeType type = NodeType::Null;
+    bool boolean = false;
+    std::string_view key;  // member name inside an object, element name in XML
+    std::string_view text; // string contents or number literal; raw source text of objects and arrays
+    DocumentNode* firstChild = nullptr;
+    DocumentNode* lastChild = nullptr;
+    DocumentNode* next = nullptr;
+    size_t childCount = 0;
+
+    const DocumentNode* find(std::string_view name) const; // first child with the given key
+};
+
+// JSON maps onto all node types; XML elements with children become objects, leaf elements strings
+class Document {
+public:
+    Document() = default;
+    Document(const Document&) = delete;
+    Document& operator=(const Document&) = delete;
+
+    // copyText = false: nodes point straight into the given text, which must outlive the tree
+    bool parseJson(std::string_view json, bool copyText = true);
+    bool parseXml(std::string_view xml, bool copyText = true);
+    const DocumentNode* root() const { return rootNode; }
+    void clear(); // O(1) in the number of nodes: only arena blocks are released
+
+private:
+    Arena arena;
+    std::string_view source; // parsed text (copied into the arena unless the caller keeps it alive), nodes point into it
+    DocumentNode* rootNode = nullptr;
+
+    DocumentNode* newNode(NodeType type, std::string_view key);
+    static void append(DocumentNode* parent, DocumentNode* child);
+    DocumentNode* parseJsonValue(const std::vector<uint32_t>& pos, size_t& i, size_t from, std::string_view key, int depth);
+};
+
+#endif // JXSL_DOCUMENT_H
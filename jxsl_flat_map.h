@@ -0,0 +1,280 @@
+// JSON/XML Simple Library (JXSL). Insertion-ordered hash map: the entries sit in one dense array in the order they
+// were added, and an open-addressing index in the SwissTable layout (one control byte per slot holding 7 bits of the
+// hash, probed 16 at a time with SSE2) maps keys to their position in it.
+
+#ifndef JXSL_FLAT_MAP_H
+#define JXSL_FLAT_MAP_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <iterator>
+#include <memory_resource>
+#include <new>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#define JXSL_FLAT_MAP_SSE2 1
+#include <emmintrin.h>
+#endif
+
+template <typename Key, typename Value, typename Hash = std::hash<Key>>
+class FlatHashMap {
+    static constexpr size_t GROUP = 16;
+    static constexpr int8_t EMPTY = -128;  // 0b10000000
+    static constexpr int8_t DELETED = -2;  // 0b11111110; full slots hold 0b0xxxxxxx
+
+public:
+    using value_type = std::pair<Key, Value>;
+
+private:
+    struct Entry {
+        size_t hash; // kept so that rebuilding the index never hashes a key again and most mismatches skip the compare
+        bool live; // erased entries stay in place as holes until the array is compacted
+        alignas(value_type) unsigned char storage[sizeof(value_type)];
+        value_type& item() { return *std::launder(reinterpret_cast<value_type*>(storage)); }
+        const value_type& item() const { return *std::launder(reinterpret_cast<const value_type*>(storage)); }
+    };
+
+public:
+    // iteration is a linear scan of the dense array: insertion order, stable across runs
+    template <bool IsConst>
+    class Iterator {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = FlatHashMap::value_type;
+        using difference_type = std::ptrdiff_t;
+        using reference = std::conditional_t<IsConst, const value_type&, value_type&>;
+        using pointer = std::conditional_t<IsConst, const value_type*, value_type*>;
+
+        Iterator() = default;
+        reference operator*() const { return map->entries[index].item(); }
+        pointer operator->() const { return &map->entries[index].item(); }
+        Iterator& operator++() {
+            index = map->nextLive(index + 1);
+            return *this;
+        }
+        Iterator operator++(int) {
+            Iterator old = *this;
+            ++*this;
+            return old;
+        }
+        bool operator==(const Iterator& other) const { return index == other.index; }
+        bool operator!=(const Iterator& other) const { return index != other.index; }
+        operator Iterator<true>() const { return Iterator<true>(map, index); }
+
+    private:
+        friend class FlatHashMap;
+        template <bool> friend class Iterator;
+        using Map = std::conditional_t<IsConst, const FlatHashMap, FlatHashMap>;
+        Iterator(Map* map, const size_t index) : map(map), index(index) {}
+        Map* map = nullptr;
+        size_t index = 0;
+    };
+    using iterator = Iterator<false>;
+    using const_iterator = Iterator<true>;
+
+    // the index and the entry array are allocated from the resource, which must outlive the map
+    explicit FlatHashMap(std::pmr::memory_resource* resource = std::pmr::get_default_resource()) : resource(resource) {}
+    FlatHashMap(const FlatHashMap&) = delete;
+    FlatHashMap& operator=(const FlatHashMap&) = delete;
+    ~FlatHashMap() { release(); }
+
+    iterator begin() { return {this, nextLive(0)}; }
+    iterator end() { return {this, used}; }
+    const_iterator begin() const { return {this, nextLive(0)}; }
+    const_iterator end() const { return {this, used}; }
+
+    size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+
+    iterator find(const Key& key) { return {this, entryOf(findSlot(key))}; }
+    const_iterator find(const Key& key) const { return {this, entryOf(findSlot(key))}; }
+
+    // appends at the end of the iteration order; may move entries (compaction or growth), which invalidates iterators
+    template <typename... Args>
+    std::pair<iterator, bool> try_emplace(Key&& key, Args&&... args) {
+        const size_t hash = Hash{}(key);
+        const size_t found = findSlot(key, hash);
+        if (found != capacity) return {{this, indices[found]}, false};
+        if (used == maxLoad(capacity)) {
+            // mostly holes: closing them is enough, otherwise the table doubles
+            rehash(capacity > 0 && count < maxLoad(capacity) / 2 ? capacity : capacityFor(count + 1));
+        }
+        const size_t index = used++;
+        Entry& entry = entries[index];
+        entry.hash = hash;
+        new (entry.storage) value_type(std::piecewise_construct, std::forward_as_tuple(std::move(key)),
+                                       std::forward_as_tuple(std::forward<Args>(args)...));
+        entry.live = true;
+        const size_t slot = freeSlot(hash);
+        indices[slot] = static_cast<uint32_t>(index);
+        setControl(slot, h2(hash));
+        ++count;
+        return {{this, index}, true};
+    }
+    template <typename... Args>
+    std::pair<iterator, bool> emplace(Key&& key, Args&&... args) {
+        return try_emplace(std::move(key), std::forward<Args>(args)...);
+    }
+
+    // the entries around the erased one keep their positions (and iterators to them stay valid)
+    size_t erase(const Key& key) {
+        const size_t slot = findSlot(key);
+        if (slot == capacity) return 0;
+        Entry& entry = entries[indices[slot]];
+        entry.item().~value_type();
+        entry.live = false;
+        setControl(slot, DELETED); // tombstone: probes for other keys must keep walking past it
+        --count;
+        return 1;
+    }
+
+    void clear() {
+        release();
+        capacity = 0;
+        count = 0;
+        used = 0;
+    }
+
+    void reserve(const size_t wanted) {
+        if (wanted > maxLoad(capacity) - (used - count)) rehash(capacityFor(wanted));
+    }
+
+private:
+    std::pmr::memory_resource* resource;
+    int8_t* control = nullptr; // capacity bytes plus a copy of the first GROUP - 1, so a group load never wraps
+    uint32_t* indices = nullptr; // per slot: position of its entry in 'entries'
+    Entry* entries = nullptr; // room for maxLoad(capacity); live entries and holes in insertion order
+    size_t capacity = 0; // index slots: power of two (or 0)
+    size_t count = 0; // live entries
+    size_t used = 0; // entries including holes; an index slot is taken for each, so the index never fills up
+
+    static int8_t h2(const size_t hash) { return static_cast<int8_t>(hash & 0x7F); }
+    static size_t h1(const size_t hash) { return hash >> 7; }
+    static size_t maxLoad(const size_t slots) { return slots - slots / 8; }
+    static size_t capacityFor(const size_t wanted) {
+        size_t result = GROUP;
+        while (maxLoad(result) < wanted) result *= 2;
+        return result;
+    }
+
+    // bit i set when control byte i of the group starting at 'index' equals 'value'
+    uint32_t match(const size_t index, const int8_t value) const {
+#ifdef JXSL_FLAT_MAP_SSE2
+        const __m128i group = _mm_loadu_si128(reinterpret_cast<const __m128i*>(control + index));
+        return static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(group, _mm_set1_epi8(value))));
+#else
+        uint32_t bits = 0;
+        for (size_t i = 0; i < GROUP; ++i) {
+            if (control[index + i] == value) bits |= 1u << i;
+        }
+        return bits;
+#endif
+    }
+    // empty or deleted slots: only their control bytes are negative
+    uint32_t matchFree(const size_t index) const {
+#ifdef JXSL_FLAT_MAP_SSE2
+        const __m128i group = _mm_loadu_si128(reinterpret_cast<const __m128i*>(control + index));
+        return static_cast<uint32_t>(_mm_movemask_epi8(group));
+#else
+        uint32_t bits = 0;
+        for (size_t i = 0; i < GROUP; ++i) {
+            if (control[index + i] < 0) bits |= 1u << i;
+        }
+        return bits;
+#endif
+    }
+
+    void setControl(const size_t index, const int8_t value) {
+        control[index] = value;
+        if (index < GROUP - 1) control[capacity + index] = value; // mirrored tail
+    }
+
+    size_t entryOf(const size_t slot) const { return slot == capacity ? used : indices[slot]; }
+
+    size_t findSlot(const Key& key) const {
+        return capacity == 0 ? 0 : findSlot(key, Hash{}(key));
+    }
+    size_t findSlot(const Key& key, const size_t hash) const {
+        if (capacity == 0) return 0;
+        const size_t mask = capacity - 1;
+        size_t position = h1(hash) & mask;
+        for (size_t step = GROUP;; step += GROUP) { // triangular probing visits every group once
+            for (uint32_t bits = match(position, h2(hash)); bits; bits &= bits - 1) {
+                const size_t slot = (position + static_cast<size_t>(__builtin_ctz(bits))) & mask;
+                const Entry& entry = entries[indices[slot]];
+                if (entry.hash == hash && entry.item().first == key) return slot;
+            }
+            if (match(position, EMPTY)) return capacity;
+            position = (position + step) & mask;
+        }
+    }
+
+    size_t freeSlot(const size_t hash) const {
+        const size_t mask = capacity - 1;
+        size_t position = h1(hash) & mask;
+        for (size_t step = GROUP;; step += GROUP) {
+            if (const uint32_t bits = matchFree(position)) {
+                return (position + static_cast<size_t>(__builtin_ctz(bits))) & mask;
+            }
+            position = (position + step) & mask;
+        }
+    }
+
+    size_t nextLive(size_t index) const {
+        while (index < used && !entries[index].live) ++index;
+        return index;
+    }
+
+    // moves the live entries, in order and without holes, into arrays for newCapacity slots and indexes them again
+    void rehash(const size_t newCapacity) {
+        int8_t* oldControl = control;
+        uint32_t* oldIndices = indices;
+        Entry* oldEntries = entries;
+        const size_t oldCapacity = capacity;
+        const size_t oldUsed = used;
+
+        control = static_cast<int8_t*>(resource->allocate(newCapacity + GROUP - 1, GROUP));
+        std::memset(control, EMPTY, newCapacity + GROUP - 1);
+        indices = static_cast<uint32_t*>(resource->allocate(newCapacity * sizeof(uint32_t), alignof(uint32_t)));
+        entries = static_cast<Entry*>(resource->allocate(maxLoad(newCapacity) * sizeof(Entry), alignof(Entry)));
+        capacity = newCapacity;
+        used = 0;
+
+        for (size_t i = 0; i < oldUsed; ++i) {
+            if (!oldEntries[i].live) continue;
+            Entry& entry = entries[used];
+            entry.hash = oldEntries[i].hash; // stored hash: no key is hashed again
+            entry.live = true;
+            new (entry.storage) value_type(std::move(oldEntries[i].item()));
+            oldEntries[i].item().~value_type();
+            const size_t slot = freeSlot(entry.hash);
+            indices[slot] = static_cast<uint32_t>(used++);
+            setControl(slot, h2(entry.hash));
+        }
+        if (oldCapacity > 0) deallocate(oldControl, oldIndices, oldEntries, oldCapacity);
+    }
+
+    void deallocate(int8_t* oldControl, uint32_t* oldIndices, Entry* oldEntries, const size_t oldCapacity) {
+        resource->deallocate(oldControl, oldCapacity + GROUP - 1, GROUP);
+        resource->deallocate(oldIndices, oldCapacity * sizeof(uint32_t), alignof(uint32_t));
+        resource->deallocate(oldEntries, maxLoad(oldCapacity) * sizeof(Entry), alignof(Entry));
+    }
+
+    void release() {
+        if (capacity == 0) return;
+        for (size_t i = 0; i < used; ++i) {
+            if (entries[i].live) entries[i].item().~value_type();
+        }
+        deallocate(control, indices, entries, capacity);
+        control = nullptr;
+        indices = nullptr;
+        entries = nullptr;
+    }
+};
+
+#endif // JXSL_FLAT_MAP_H
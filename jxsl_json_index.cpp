@@ -0,0 +1,161 @@
+// JSON/XML Simple Library (JXSL). Structural index of a JSON text: 64-byte blocks are classified with AVX2 or SSE4.2
+// when the CPU supports them (scalar fallback otherwise), then quotes are paired with bit tricks to mask out strings.
+#include "jxsl_json_index.h"
+#include <bit>
+#include <cstring>
+#include <limits>
+#include <utility>
+
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define JXSL_X86_SIMD 1
+#include <immintrin.h>
+#endif
+
+namespace {
+
+constexpr size_t BLOCK_SIZE = 64;
+
+struct BlockMasks {
+    uint64_t quote = 0;
+    uint64_t backslash = 0;
+    uint64_t structural = 0;
+};
+
+using Classifier = void (*)(const char* block, BlockMasks& masks);
+
+bool isStructural(const char c) {
+    return c == '{' || c == '}' || c == '[' || c == ']' || c == ':' || c == ',';
+}
+
+void classifyScalar(const char* block, BlockMasks& masks) {
+    masks = {};
+    for (size_t i = 0; i < BLOCK_SIZE; ++i) {
+        const uint64_t bit = uint64_t{1} << i;
+        const char c = block[i];
+        if (c == '"') masks.quote |= bit;
+        else if (c == '\\') masks.backslash |= bit;
+        else if (isStructural(c)) masks.structural |= bit;
+    }
+}
+
+#ifdef JXSL_X86_SIMD
+__attribute__((target("avx2")))
+void classifyAvx2Half(const char* half, uint32_t& quote, uint32_t& backslash, uint32_t& structural) {
+    const __m256i chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(half));
+    const __m256i braces = _mm256_or_si256(_mm256_cmpeq_epi8(chunk, _mm256_set1_epi8('{')),
+                                           _mm256_cmpeq_epi8(chunk, _mm256_set1_epi8('}')));
+    const __m256i brackets = _mm256_or_si256(_mm256_cmpeq_epi8(chunk, _mm256_set1_epi8('[')),
+                                             _mm256_cmpeq_epi8(chunk, _mm256_set1_epi8(']')));
+    const __m256i separators = _mm256_or_si256(_mm256_cmpeq_epi8(chunk, _mm256_set1_epi8(':')),
+                                               _mm256_cmpeq_epi8(chunk, _mm256_set1_epi8(',')));
+    quote = static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(chunk, _mm256_set1_epi8('"'))));
+    backslash = static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(chunk, _mm256_set1_epi8('\\'))));
+    structural = static_cast<uint32_t>(_mm256_movemask_epi8(
+        _mm256_or_si256(braces, _mm256_or_si256(brackets, separators))));
+}
+
+__attribute__((target("avx2")))
+void classifyAvx2(const char* block, BlockMasks& masks) {
+    uint32_t quoteLo, backslashLo, structuralLo, quoteHi, backslashHi, structuralHi;
+    classifyAvx2Half(block, quoteLo, backslashLo, structuralLo);
+    classifyAvx2Half(block + 32, quoteHi, backslashHi, structuralHi);
+    masks.quote = quoteLo | (uint64_t{quoteHi} << 32);
+    masks.backslash = backslashLo | (uint64_t{backslashHi} << 32);
+    masks.structural = structuralLo | (uint64_t{structuralHi} << 32);
+}
+
+__attribute__((target("sse4.2")))
+void classifySse42(const char* block, BlockMasks& masks) {
+    // PCMPESTRM compares every byte of the chunk against the whole structural set at once
+    const __m128i structuralSet = _mm_setr_epi8('{', '}', '[', ']', ':', ',', 0, 0, 0, 0, 0, 0, 0, 0, 0, 0);
+    const __m128i quoteChar = _mm_set1_epi8('"');
+    const __m128i backslashChar = _mm_set1_epi8('\\');
+    masks = {};
+    for (size_t offset = 0; offset < BLOCK_SIZE; offset += 16) {
+        const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(block + offset));
+        const __m128i structural = _mm_cmpestrm(structuralSet, 6, chunk, 16,
+                                                _SIDD_UBYTE_OPS | _SIDD_CMP_EQUAL_ANY | _SIDD_BIT_MASK);
+        masks.structural |= uint64_t{static_cast<uint16_t>(_mm_cvtsi128_si32(structural))} << offset;
+        masks.quote |= uint64_t{static_cast<uint16_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(chunk, quoteChar)))} << offset;
+        masks.backslash |= uint64_t{static_cast<uint16_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(chunk, backslashChar)))}
+                           << offset;
+    }
+}
+#endif
+
+Classifier selectClassifier() {
+#ifdef JXSL_X86_SIMD
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) return classifyAvx2;
+    if (__builtin_cpu_supports("sse4.2")) return classifySse42;
+#endif
+    return classifyScalar;
+}
+
+// characters preceded by an unescaped backslash; escapes are rare, so set bits are walked one by one
+uint64_t findEscaped(uint64_t backslash, uint64_t& carry) {
+    uint64_t escaped = carry;
+    carry = 0;
+    backslash &= ~escaped; // an escaped backslash does not escape the next character
+    while (backslash) {
+        const int i = std::countr_zero(backslash);
+        backslash &= backslash - 1;
+        if ((escaped >> i) & 1) continue;
+        if (i == 63) {
+            carry = 1;
+        } else {
+            escaped |= uint64_t{1} << (i + 1);
+        }
+    }
+    return escaped;
+}
+
+// bit i is set when an odd number of quotes is at or before position i
+uint64_t prefixXor(uint64_t bits) {
+    bits ^= bits << 1;
+    bits ^= bits << 2;
+    bits ^= bits << 4;
+    bits ^= bits << 8;
+    bits ^= bits << 16;
+    bits ^= bits << 32;
+    return bits;
+}
+
+} // namespace
+
+bool JsonIndex::build(const std::string_view text) {
+    static const Classifier classify = selectClassifier();
+
+    json = text;
+    structurals.clear();
+    if (text.size() > std::numeric_limits<uint32_t>::max()) return false;
+    structurals.reserve(text.size() / 16 + 16);
+
+    uint64_t escapeCarry = 0;
+    uint64_t inStringCarry = 0;
+    BlockMasks masks;
+    char tail[BLOCK_SIZE];
+
+    for (size_t base = 0; base < text.size(); base += BLOCK_SIZE) {
+        const char* block = text.data() + base;
+        if (text.size() - base < BLOCK_SIZE) {
+            std::memset(tail, ' ', BLOCK_SIZE);
+            std::memcpy(tail, block, text.size() - base);
+            block = tail;
+        }
+        classify(block, masks);
+
+        const uint64_t escaped = masks.backslash ? findEscaped(masks.backslash, escapeCarry)
+                                                 : std::exchange(escapeCarry, 0);
+        const uint64_t quotes = masks.quote & ~escaped;
+        const uint64_t inString = prefixXor(quotes) ^ inStringCarry;
+        inStringCarry = (inString >> 63) ? ~uint64_t{0} : 0;
+
+        uint64_t bits = (masks.structural & ~inString) | quotes;
+        while (bits) {
+            structurals.push_back(static_cast<uint32_t>(base + std::countr_zero(bits)));
+            bits &= bits - 1;
+        }
+    }
+    return inStringCarry == 0; // an unterminated string is malformed
+}
@@ -0,0 +1,23 @@
+// JSON/XML Simple Library (JXSL). Structural index of a JSON text (SIMD with scalar fallback) that the document parser walks.
+
+#ifndef JXSL_JSON_INDEX_H
+#define JXSL_JSON_INDEX_H
+
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+class JsonIndex {
+public:
+    // index every unescaped quote and every '{', '}', '[', ']', ':', ',' outside of strings
+    bool build(std::string_view json);
+
+    const std::vector<uint32_t>& positions() const { return structurals; }
+    std::string_view text() const { return json; }
+
+private:
+    std::string_view json;
+    std::vector<uint32_t> structurals; // offsets into json in ascending order (texts up to 4 GB)
+};
+
+#endif // JXSL_JSON_INDEX_H
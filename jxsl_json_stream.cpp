@@ -0,0 +1,245 @@
+// JSON/XML Simple Library (JXSL). Push-based (SAX-style) JSON parser: a state machine over fixed-size chunks. Only a token
+// cut by a chunk boundary is buffered, so memory stays bounded by the chunk size, the longest token and the nesting depth.
+#include "jxsl_json_stream.h"
+#include <cstring>
+#include <fstream>
+
+namespace {
+
+bool isWhitespace(const char c) {
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+bool isDelimiter(const char c) {
+    return c == ',' || c == '}' || c == ']' || isWhitespace(c);
+}
+
+// index of the closing quote at or after 'from', or npos; 'escaped' carries a trailing backslash across chunks
+size_t findStringEnd(const char* data, const size_t size, size_t from, bool& escaped) {
+    if (escaped) {
+        if (from >= size) return std::string::npos;
+        escaped = false;
+        ++from;
+    }
+    for (size_t i = from; i < size; ++i) {
+        if (data[i] == '\\') {
+            if (++i == size) {
+                escaped = true;
+                break;
+            }
+        } else if (data[i] == '"') {
+            return i;
+        }
+    }
+    return std::string::npos;
+}
+
+size_t findLiteralEnd(const char* data, const size_t size, const size_t from) {
+    for (size_t i = from; i < size; ++i) {
+        if (isDelimiter(data[i])) return i;
+    }
+    return std::string::npos;
+}
+
+bool isDigit(const char c) {
+    return c >= '0' && c <= '9';
+}
+
+// JSON number grammar: -?(0|[1-9][0-9]*)(.[0-9]+)?([eE][+-]?[0-9]+)?
+bool isNumber(const std::string_view literal) {
+    size_t i = 0;
+    const auto digits = [&] {
+        const size_t start = i;
+        while (i < literal.size() && isDigit(literal[i])) ++i;
+        return i > start;
+    };
+    if (i < literal.size() && literal[i] == '-') ++i;
+    if (i < literal.size() && literal[i] == '0') {
+        ++i;
+    } else if (!digits()) {
+        return false;
+    }
+    if (i < literal.size() && literal[i] == '.') {
+        ++i;
+        if (!digits()) return false;
+    }
+    if (i < literal.size() && (literal[i] == 'e' || literal[i] == 'E')) {
+        ++i;
+        if (i < literal.size() && (literal[i] == '+' || literal[i] == '-')) ++i;
+        if (!digits()) return false;
+    }
+    return i == literal.size();
+}
+
+} // namespace
+
+JsonStreamParser::JsonStreamParser(JsonHandler& handler, const size_t chunkSize, const size_t maxTokenSize)
+    : handler(handler), chunkSize(chunkSize), maxTokenSize(maxTokenSize), expect(Expect::Value), token(Token::None),
+      escaped(false) {}
+
+bool JsonStreamParser::parseFile(const std::string& filename) {
+    std::ifstream file(filename, std::ios::binary);
+    if (!file.is_open()) return fail("Unable to open file: " + filename);
+
+    std::vector<char> chunk(chunkSize);
+    while (file) {
+        file.read(chunk.data(), static_cast<std::streamsize>(chunk.size()));
+        if (!feed(chunk.data(), static_cast<size_t>(file.gcount()))) return false;
+    }
+    return finish();
+}
+
+bool JsonStreamParser::fail(const std::string& message) {
+    if (errorMessage.empty()) errorMessage = message;
+    expect = Expect::Done;
+    return false;
+}
+
+bool JsonStreamParser::appendCarry(const char* data, const size_t size) {
+    if (carry.size() + size > maxTokenSize) return fail("Token exceeds the maximum token size");
+    carry.append(data, size);
+    return true;
+}
+
+bool JsonStreamParser::afterValue() {
+    expect = containers.empty() ? Expect::Done : Expect::CommaOrEnd;
+    return true;
+}
+
+bool JsonStreamParser::emitString(const std::string_view contents) {
+    if (expect == Expect::Key || expect == Expect::KeyOrEnd) {
+        handler.onKey(contents);
+        expect = Expect::Colon;
+        return true;
+    }
+    handler.onString(contents);
+    return afterValue();
+}
+
+bool JsonStreamParser::emitLiteral(const std::string_view literal) {
+    if (literal == "true" || literal == "false") {
+        handler.onBool(literal == "true");
+    } else if (literal == "null") {
+        handler.onNull();
+    } else if (isNumber(literal)) {
+        handler.onNumber(literal);
+    } else {
+        return fail("Invalid literal: " + std::string(literal));
+    }
+    return afterValue();
+}
+
+bool JsonStreamParser::feed(const char* data, const size_t size) {
+    if (!errorMessage.empty()) return false;
+
+    size_t i = 0;
+    // finish the token cut by the previous chunk boundary
+    if (token == Token::String) {
+        const size_t end = findStringEnd(data, size, 0, escaped);
+        if (end == std::string::npos) return appendCarry(data, size);
+        if (!appendCarry(data, end)) return false;
+        token = Token::None;
+        if (!emitString(carry)) return false;
+        carry.clear();
+        i = end + 1;
+    } else if (token == Token::Literal) {
+        const size_t end = findLiteralEnd(data, size, 0);
+        if (end == std::string::npos) return appendCarry(data, size);
+        if (!appendCarry(data, end)) return false;
+        token = Token::None;
+        if (!emitLiteral(carry)) return false;
+        carry.clear();
+        i = end;
+    }
+
+    while (i < size) {
+        const char c = data[i];
+        if (isWhitespace(c)) {
+            ++i;
+            continue;
+        }
+        if (expect == Expect::Done) return fail("Unexpected data after the end of the document");
+
+        const bool valueExpected = expect == Expect::Value || expect == Expect::ValueOrEnd;
+        switch (c) {
+            case '{':
+            case '[':
+                if (!valueExpected) return fail(std::string("Unexpected '") + c + "'");
+                containers.push_back(c);
+                if (c == '{') {
+                    handler.onStartObject();
+                    expect = Expect::KeyOrEnd;
+                } else {
+                    handler.onStartArray();
+                    expect = Expect::ValueOrEnd;
+                }
+                ++i;
+                break;
+            case '}':
+            case ']': {
+                const char open = c == '}' ? '{' : '[';
+                const bool canClose = expect == Expect::CommaOrEnd || expect == (c == '}' ? Expect::KeyOrEnd : Expect::ValueOrEnd);
+                if (!canClose || containers.empty() || containers.back() != open) {
+                    return fail(std::string("Unexpected '") + c + "'");
+                }
+                containers.pop_back();
+                if (c == '}') {
+                    handler.onEndObject();
+                } else {
+                    handler.onEndArray();
+                }
+                afterValue();
+                ++i;
+                break;
+            }
+            case ':':
+                if (expect != Expect::Colon) return fail("Unexpected ':'");
+                expect = Expect::Value;
+                ++i;
+                break;
+            case ',':
+                if (expect != Expect::CommaOrEnd) return fail("Unexpected ','");
+                expect = containers.back() == '{' ? Expect::Key : Expect::Value;
+                ++i;
+                break;
+            case '"': {
+                if (!valueExpected && expect != Expect::Key && expect != Expect::KeyOrEnd) return fail("Unexpected string");
+                escaped = false;
+                const size_t end = findStringEnd(data, size, i + 1, escaped);
+                if (end == std::string::npos) {
+                    token = Token::String;
+                    carry.clear();
+                    return appendCarry(data + i + 1, size - i - 1);
+                }
+                if (!emitString({data + i + 1, end - i - 1})) return false;
+                i = end + 1;
+                break;
+            }
+            default: {
+                if (!valueExpected) return fail(std::string("Unexpected '") + c + "'");
+                const size_t end = findLiteralEnd(data, size, i);
+                if (end == std::string::npos) {
+                    token = Token::Literal;
+                    carry.clear();
+                    return appendCarry(data + i, size - i);
+                }
+                if (!emitLiteral({data + i, end - i})) return false;
+                i = end;
+                break;
+            }
+        }
+    }
+    return true;
+}
+
+bool JsonStreamParser::finish() {
+    if (!errorMessage.empty()) return false;
+    if (token == Token::String) return fail("Unterminated string");
+    if (token == Token::Literal) {
+        token = Token::None;
+        if (!emitLiteral(carry)) return false;
+        carry.clear();
+    }
+    if (expect != Expect::Done) return fail("Unexpected end of input");
+    return true;
+}
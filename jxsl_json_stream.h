@@ -0,0 +1,57 @@
+// JSON/XML Simple Library (JXSL). Push-based (SAX-style) JSON parser reading fixed-size chunks in constant memory.
+
+#ifndef JXSL_JSON_STREAM_H
+#define JXSL_JSON_STREAM_H
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// receives parse events; the views are valid only for the duration of the call
+class JsonHandler {
+public:
+    virtual ~JsonHandler() = default;
+    virtual void onStartObject() {}
+    virtual void onEndObject() {}
+    virtual void onStartArray() {}
+    virtual void onEndArray() {}
+    virtual void onKey(std::string_view /*key*/) {}
+    virtual void onString(std::string_view /*value*/) {} // raw contents, escapes are not decoded
+    virtual void onNumber(std::string_view /*literal*/) {}
+    virtual void onBool(bool /*value*/) {}
+    virtual void onNull() {}
+};
+
+class JsonStreamParser {
+public:
+    explicit JsonStreamParser(JsonHandler& handler, size_t chunkSize = 64 * 1024, size_t maxTokenSize = 1024 * 1024);
+
+    bool parseFile(const std::string& filename); // reads the file chunk by chunk
+    bool feed(const char* data, size_t size);    // push the next piece of input
+    bool finish();                               // end of input: the document must be complete
+    const std::string& error() const { return errorMessage; }
+
+private:
+    enum class Expect { Value, KeyOrEnd, Key, Colon, CommaOrEnd, ValueOrEnd, Done };
+    enum class Token { None, String, Literal };
+
+    JsonHandler& handler;
+    size_t chunkSize;
+    size_t maxTokenSize;
+    Expect expect;
+    std::vector<char> containers; // '{' or '[' per open level: memory grows only with nesting depth
+    Token token;                  // token that continues past the end of the last chunk
+    std::string carry;            // its bytes so far (bounded by maxTokenSize)
+    bool escaped;                 // inside a string: the last byte was an unescaped backslash
+    std::string errorMessage;
+
+    bool fail(const std::string& message);
+    bool emitString(std::string_view contents);
+    bool emitLiteral(std::string_view literal);
+    bool afterValue();
+    bool appendCarry(const char* data, size_t size);
+};
+
+#endif // JXSL_JSON_STREAM_H
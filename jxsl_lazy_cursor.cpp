@@ -0,0 +1,115 @@
+// JSON/XML Simple Library (JXSL). Incremental scanner used by the lazy load mode: each call scans only up to the next entry.
+#include "jxsl_lazy_cursor.h"
+
+LazyCursor::LazyCursor(const std::string_view text, const bool isJson)
+    : text(text), isJson(isJson), pos(0), started(false), finished(false), malformed(false), xml(text) {}
+
+bool LazyCursor::next(std::string_view& key, std::string_view& value, NodeType& type) {
+    if (!isJson) {
+        type = NodeType::String;
+        const bool found = xml.nextElement(key, value);
+        malformed = xml.failed();
+        return found;
+    }
+    return nextJson(key, value, type);
+}
+
+bool LazyCursor::fail() {
+    finished = malformed = true;
+    return false;
+}
+
+size_t LazyCursor::skipWhitespace(size_t from) const {
+    while (from < text.size() && (text[from] == ' ' || text[from] == '\t' || text[from] == '\r' || text[from] == '\n')) {
+        ++from;
+    }
+    return from;
+}
+
+size_t LazyCursor::stringEnd(const size_t openQuote) const {
+    size_t from = openQuote + 1;
+    while (true) {
+        const size_t quote = text.find('"', from);
+        if (quote == std::string_view::npos) return quote;
+        size_t backslashes = 0;
+        while (quote - backslashes > openQuote + 1 && text[quote - backslashes - 1] == '\\') ++backslashes;
+        if (backslashes % 2 == 0) return quote;
+        from = quote + 1;
+    }
+}
+
+size_t LazyCursor::containerEnd(const size_t openBracket) const {
+    size_t depth = 0;
+    size_t at = openBracket;
+    while (at != std::string_view::npos) {
+        at = text.find_first_of("{}[]\"", at);
+        if (at == std::string_view::npos) break;
+        const char c = text[at];
+        if (c == '"') {
+            at = stringEnd(at);
+            if (at == std::string_view::npos) break;
+        } else if (c == '{' || c == '[') {
+            ++depth;
+        } else if (--depth == 0) {
+            return at;
+        }
+        ++at;
+    }
+    return std::string_view::npos;
+}
+
+bool LazyCursor::nextJson(std::string_view& key, std::string_view& value, NodeType& type) {
+    if (finished) return false;
+    pos = skipWhitespace(pos);
+    if (!started) {
+        if (pos >= text.size() || text[pos] != '{') return fail();
+        started = true;
+        pos = skipWhitespace(pos + 1);
+        if (pos < text.size() && text[pos] == '}') {
+            finished = true;
+            return false;
+        }
+    }
+
+    // "key" :
+    if (pos >= text.size() || text[pos] != '"') return fail();
+    const size_t keyEnd = stringEnd(pos);
+    if (keyEnd == std::string_view::npos) return fail();
+    key = text.substr(pos + 1, keyEnd - pos - 1);
+    pos = skipWhitespace(keyEnd + 1);
+    if (pos >= text.size() || text[pos] != ':') return fail();
+    pos = skipWhitespace(pos + 1);
+    if (pos >= text.size()) return fail();
+
+    const char first = text[pos];
+    if (first == '"') {
+        type = NodeType::String;
+        const size_t end = stringEnd(pos);
+        if (end == std::string_view::npos) return fail();
+        value = text.substr(pos + 1, end - pos - 1);
+        pos = end + 1;
+    } else if (first == '{' || first == '[') {
+        const size_t end = containerEnd(pos);
+        if (end == std::string_view::npos) return fail();
+        value = text.substr(pos, end - pos + 1);
+        type = first == '{' ? NodeType::Object : NodeType::Array;
+        pos = end + 1;
+    } else {
+        const size_t end = text.find_first_of(",} \t\r\n", pos);
+        if (end == std::string_view::npos || end == pos) return fail();
+        value = text.substr(pos, end - pos);
+        type = value == "true" || value == "false" ? NodeType::Bool : value == "null" ? NodeType::Null : NodeType::Number;
+        pos = end;
+    }
+
+    // separator: ',' continues, '}' ends the object after this entry
+    pos = skipWhitespace(pos);
+    if (pos >= text.size()) return fail();
+    if (text[pos] == '}') {
+        finished = true;
+    } else if (text[pos] != ',') {
+        return fail();
+    }
+    ++pos;
+    return true;
+}
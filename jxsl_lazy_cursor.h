@@ -0,0 +1,36 @@
+// JSON/XML Simple Library (JXSL). Incremental scanner that locates top-level entries of a mapped document one at a time.
+
+#ifndef JXSL_LAZY_CURSOR_H
+#define JXSL_LAZY_CURSOR_H
+
+#include "jxsl_document.h"
+#include "jxsl_xml_tokenizer.h"
+#include <cstddef>
+#include <string_view>
+
+class LazyCursor {
+public:
+    LazyCursor(std::string_view text, bool isJson);
+
+    // next top-level entry (views into the text): JSON strings without their quotes, the literals of other scalars
+    // and the raw text of objects/arrays; XML values are always strings
+    bool next(std::string_view& key, std::string_view& value, NodeType& type);
+    bool failed() const { return malformed; }
+
+private:
+    std::string_view text;
+    bool isJson;
+    size_t pos;
+    bool started;
+    bool finished;
+    bool malformed;
+    XmlTokenizer xml;
+
+    bool nextJson(std::string_view& key, std::string_view& value, NodeType& type);
+    bool fail();
+    size_t skipWhitespace(size_t from) const;
+    size_t stringEnd(size_t openQuote) const; // position of the closing quote or npos
+    size_t containerEnd(size_t openBracket) const; // position of the matching bracket or npos
+};
+
+#endif // JXSL_LAZY_CURSOR_H
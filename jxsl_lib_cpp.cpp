@@ -1,221 +1,1104 @@
 // JSON/XML Simple Library (JXSL). Class that contains main functions to operate with JSON/XML files with deffered recording optimization.
 #include "jxsl_lib_cpp.h"
+#include "jxsl_json_index.h"
+#include "jxsl_xml_tokenizer.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
 #include <fstream>
-#include <sstream>
+#include <future>
 #include <iostream>
-#include <algorithm>
 
-constexpr int FLUSH_THRESHOLD = 10;
+#if defined(__unix__) || defined(__APPLE__)
+#define JXSL_POSIX_IO 1
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
 
-JXSL::JXSL(const std::string& filename)
-    : filename(filename), isJson(filename.find(".json") != std::string::npos), pendingChanges(0) {
-    const std::string content = readFile();
-    if (isJson) {
-        parseJson(content);
-    } else {
-        parseXml(content);
+namespace {
+
+char* put(char* out, const std::string_view text) {
+    std::memcpy(out, text.data(), text.size());
+    return out + text.size();
+}
+
+bool isSpace(const char c) {
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+// end of the edit padding (spaces and tabs) at 'at': a member owns it, but not the line break and indent after it, so
+// an edit padded into it never joins lines (which the C library reads one at a time)
+size_t padding(const std::string_view text, size_t at) {
+    while (at < text.size() && (text[at] == ' ' || text[at] == '\t')) ++at;
+    return at;
+}
+
+#ifdef JXSL_POSIX_IO
+bool writeAt(const int fd, const char* data, size_t size, size_t offset) {
+    while (size > 0) { // a short write (or the rest of one) is finished synchronously
+        const ssize_t written = pwrite(fd, data, size, static_cast<off_t>(offset));
+        if (written <= 0) return false;
+        data += written;
+        size -= static_cast<size_t>(written);
+        offset += static_cast<size_t>(written);
+    }
+    return true;
+}
+#endif
+
+} // namespace
+
+JXSL::JXSL(const std::string& filename, const JxslOptions& options)
+    : filename(filename), isJson(filename.find(".json") != std::string::npos),
+      compressed(options.compress || filename.ends_with(CompressedFile::EXTENSION)), memoryMap(options.memoryMap),
+      zeroCopy(options.zeroCopy),
+      resource(options.memoryResource ? options.memoryResource : std::pmr::get_default_resource()), io(options.asyncIo),
+      data(resource),
+      output(resource), entryOffsets(resource), mapped(resource), container(resource), blockRead(resource), blocksLeft(0),
+      blocksOutOfOrder(false), pendingChanges(0),
+      policy(options.flushPolicy), treeStale(false), disk(resource), wal(resource), job(resource), dirtyBytes(0),
+      firstChangeAt(std::chrono::steady_clock::now()), writing(false), stopFlusher(false), patchInPlace(options.patchInPlace) {
+    // taken before the contents are read: a change made in between makes the stamp stale, never the layout
+    statFile(disk.stamp);
+    if (options.loadMode == LoadMode::Lazy) {
+        if (readFile(false)) {
+            if (CompressedFile::detect(mapped.view())) {
+                openContainer(true);
+            } else if (mapped.view().find(isJson ? '{' : '<') != std::string_view::npos) {
+                cursor = std::make_unique<LazyCursor>(mapped.view(), isJson);
+                locateClose(mapped.view());
+                if (isJson) { // members exist unless the first thing after the brace closes the object
+                    const std::string_view text = mapped.view();
+                    const size_t first = text.find_first_not_of(" \t\r\n", text.find('{') + 1);
+                    disk.hasMembers = first != std::string_view::npos && text[first] != '}';
+                } else {
+                    disk.hasMembers = true; // only decides about a leading comma, which XML does not have
+                }
+            }
+            treeStale = true; // the tree is built on the first documentRoot() call
+        }
+    } else if (readFile(true) && (!CompressedFile::detect(mapped.view()) || openContainer(false))) {
+        if (isJson) {
+            parseJson(mapped.view());
+        } else {
+            parseXml(mapped.view());
+        }
+    }
+
+    if (options.writeAheadLog) {
+        replayLog();
+    }
+    if (options.backgroundFlush) {
+        flusher = std::thread(&JXSL::runFlusher, this);
+    }
+}
+
+JXSL::~JXSL() {
+    if (flusher.joinable()) {
+        {
+            std::lock_guard<std::mutex> lock(stateMutex);
+            stopFlusher = true;
+        }
+        flushWake.notify_one();
+        flusher.join();
+    }
+    if (policy.flushOnDestruction) {
+        flushToFile(); // changes below the limits would be lost otherwise (with the log they would be replayed)
     }
 }
 
 // deferred data recording
 void JXSL::flushToFile() {
-    if (pendingChanges == 0) return; // if there is no changes - do nothing
+    flush(false);
+}
+
+void JXSL::sync() {
+    flush(true);
+}
+
+void JXSL::setFlushPolicy(const FlushPolicy& newPolicy) {
+    std::unique_lock<std::mutex> lock(stateMutex);
+    policy = newPolicy;
+    if (flusher.joinable()) {
+        flushWake.notify_one(); // the flusher picks up the new limits
+    } else if (flushDue()) {
+        lock.unlock();
+        flushToFile();
+    }
+}
+
+FlushStats JXSL::flushStats() const {
+    std::lock_guard<std::mutex> lock(stateMutex);
+    return stats;
+}
+
+void JXSL::flush(const bool durable) {
+    std::lock_guard<std::mutex> flushing(flushMutex);
+    std::unique_lock<std::mutex> lock(stateMutex);
+    if (pendingChanges == 0) { // if there is no changes - do nothing
+        lock.unlock();
+        if (durable) syncFile(); // an earlier flush may have left the file in the page cache only
+        return;
+    }
     std::cout << "Flushing changes to file...\n";
+    const auto start = std::chrono::steady_clock::now();
 
-    const std::string content = isJson ? toJson() : toXml();
-    writeFile(content);
+    if (wal.isOpen()) {
+        wal.commit(); // every change is in the log before the file is touched
+    }
+    job.logEnd = wal.size();
+    job.patches.clear();
+    job.bytes.clear();
+    if (disk.known && !fileUnchanged()) {
+        if (zeroCopy && mapped.isMapped()) {
+            // the unmodified entries view the mapping, which shows the other writer's bytes now: a rewrite would put
+            // whatever they happen to cover into the file. The changes stay pending
+            std::cerr << "Error: File changed while its entries were mapped, not writing it: " << filename << "\n";
+            stats.failedFlushes++;
+            firstChangeAt = std::chrono::steady_clock::now();
+            return;
+        }
+        // written by someone else since it was read: the offsets are stale, and patches would land in the wrong places;
+        // the entries own their bytes (or view a private copy), so the rewrite holds the file as loaded plus the changes
+        std::cerr << "Error: File changed since it was read, rewriting it: " << filename << "\n";
+        disk.known = false;
+    }
+    // usually only the changed members are written; the layout shifts only when a JSON object loses its first member
+    // or when too much of the file is blank space left by deleted members
+    job.rewrite = !planPatches();
+    if (job.rewrite) {
+        job.patches.clear();
+        job.bytes.clear();
+        planRewrite();
+    }
+    const int changes = pendingChanges;
+    const size_t changedBytes = dirtyBytes;
     pendingChanges = 0; // restore change counter
+    dirtyBytes = 0;
+
+    // the job is a snapshot: changes made while it is written wait for the next flush
+    writing = true;
+    lock.unlock();
+    const bool written = writeJob(durable || wal.isOpen());
+    lock.lock();
+    writing = false;
+    const auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start);
+    stats.flushTime += elapsed;
+    stats.longestFlush = std::max(stats.longestFlush, elapsed);
+    if (!written) {
+        disk.known = false; // a rewrite repairs whatever was written partially
+        pendingChanges++;
+        firstChangeAt = std::chrono::steady_clock::now();
+        stats.failedFlushes++;
+        return;
+    }
+    statFile(disk.stamp); // the file as this flush left it
+    stats.flushes++;
+    stats.rewrites += job.rewrite ? 1 : 0;
+    stats.changesFlushed += static_cast<uint64_t>(changes);
+    stats.bytesChanged += changedBytes;
+    if (job.rewrite) {
+        stats.bytesWritten += compressed ? job.packed.size() : job.content.size();
+    } else {
+        for (const FlushJob::Patch& patch : job.patches) stats.bytesWritten += patch.length;
+    }
+    if (wal.isOpen()) {
+        wal.discardUpTo(job.logEnd); // checkpoint: the file is durable, the log keeps only the newer changes
+    }
+}
+
+bool JXSL::flushDue() const {
+    if (policy.manualOnly || pendingChanges == 0) return false;
+    return (policy.maxPendingChanges > 0 && pendingChanges >= policy.maxPendingChanges) ||
+           (policy.maxDirtyBytes > 0 && dirtyBytes >= policy.maxDirtyBytes) ||
+           (policy.maxAge.count() > 0 && std::chrono::steady_clock::now() - firstChangeAt >= policy.maxAge);
+}
+
+void JXSL::recordChange(std::unique_lock<std::mutex>& lock, const size_t bytes) {
+    if (pendingChanges++ == 0) {
+        firstChangeAt = std::chrono::steady_clock::now();
+    }
+    dirtyBytes += bytes;
+    if (flusher.joinable()) {
+        // the first change starts the flusher's timer
+        if (pendingChanges == 1 || flushDue()) flushWake.notify_one();
+    } else if (flushDue()) {
+        lock.unlock();
+        flushToFile();
+    }
+}
+
+void JXSL::runFlusher() {
+    std::unique_lock<std::mutex> lock(stateMutex);
+    while (!stopFlusher) {
+        if (flushDue()) {
+            const uint64_t failed = stats.failedFlushes;
+            lock.unlock();
+            flushToFile();
+            lock.lock();
+            if (stats.failedFlushes != failed) {
+                flushWake.wait_for(lock, std::chrono::seconds(1)); // retry later rather than in a tight loop
+            }
+        } else if (pendingChanges > 0 && policy.maxAge.count() > 0 && !policy.manualOnly) {
+            flushWake.wait_until(lock, firstChangeAt + policy.maxAge);
+        } else {
+            flushWake.wait(lock);
+        }
+    }
+}
+
+void JXSL::replayLog() {
+    if (!wal.open(filename + ".wal")) return;
+    // changes logged after the last checkpoint are applied again (they are not logged a second time)
+    const bool replayed = wal.replay([this](const WalOp op, const std::string_view key, const std::string_view value) {
+        if (lazyPending() && data.find(SourceString(key)) == data.end()) {
+            materialize(key);
+        }
+        if (op == WalOp::Put) {
+            applyPut(key, value);
+        } else {
+            applyDelete(key);
+        }
+        pendingChanges++;
+    });
+    if (!replayed) {
+        std::cerr << "Error: Unable to read log: " << filename << ".wal\n";
+    }
+    if (flushDue()) {
+        flushToFile();
+    }
+}
+
+bool JXSL::statFile(FileStamp& stamp) const {
+    stamp = {};
+#ifdef JXSL_POSIX_IO
+    struct stat info {};
+    if (stat(filename.c_str(), &info) != 0) return false;
+#ifdef __APPLE__
+    const timespec modified = info.st_mtimespec;
+    const timespec changed = info.st_ctimespec;
+#else
+    const timespec modified = info.st_mtim;
+    const timespec changed = info.st_ctim;
+#endif
+    stamp.size = static_cast<uint64_t>(info.st_size);
+    stamp.inode = static_cast<uint64_t>(info.st_ino);
+    stamp.modified = static_cast<int64_t>(modified.tv_sec) * 1000000000 + modified.tv_nsec;
+    stamp.changed = static_cast<int64_t>(changed.tv_sec) * 1000000000 + changed.tv_nsec;
+    return true;
+#else
+    return false;
+#endif
+}
+
+bool JXSL::fileUnchanged() const {
+    FileStamp current;
+    return statFile(current) && current == disk.stamp;
+}
+
+bool JXSL::syncFile() const {
+#ifdef JXSL_POSIX_IO
+    // the directory too: a rewrite replaced the file by renaming
+    const size_t slash = filename.rfind('/');
+    const std::string directory = slash == std::string::npos ? "." : slash == 0 ? "/" : filename.substr(0, slash);
+    bool synced = true;
+    for (const std::string& path : {filename, directory}) {
+        const int fd = ::open(path.c_str(), O_RDONLY);
+        synced = synced && fd >= 0 && fsync(fd) == 0;
+        if (fd >= 0) ::close(fd);
+    }
+    return synced;
+#else
+    return false;
+#endif
+}
+
+void JXSL::planRewrite() {
+    if (zeroCopy) {
+        // the written text becomes the source buffer: entries move onto it before the old mapping is truncated under
+        // them, and edited entries give up their private copies. The previous buffer comes back as 'output'
+        serialize(output, &entryOffsets);
+        mapped.exchange(output);
+        rebaseEntries(entryOffsets);
+        job.content = mapped.view(); // nothing replaces the source buffer before the next flush
+    } else {
+        job.content = serialize(job.bytes, &entryOffsets);
+        mapped.close();
+    }
+    disk = DiskLayout(resource);
+
+    // every member is where the serializer put it
+    job.members.clear();
+    size_t i = 0;
+    for (auto& [key, entry] : data) {
+        locate(entry, job.content, entryOffsets[i], entryOffsets[i + 1]);
+        entry.changed = false;
+        entry.onDisk = true;
+        if (compressed) { // a block may start at the indentation in front of any key ("    \"" or "    <")
+            job.members.push_back({entryOffsets[i] - 5, job.content.substr(entryOffsets[i], key.size())});
+        }
+        i += 2;
+    }
+    locateClose(job.content);
+    disk.hasMembers = !data.empty();
+}
+
+bool JXSL::writeJob(const bool durable) {
+    if (job.rewrite) {
+        std::string_view content = job.content;
+        if (compressed) { // compressing is the slow part: it happens here, without the lock
+            CompressedFile::pack(job.content, job.members, isJson, job.packed);
+            content = job.packed;
+        }
+        return writeFile(content) && (!durable || syncFile());
+    }
+#ifdef JXSL_POSIX_IO
+    const int fd = ::open(filename.c_str(), O_WRONLY);
+    const bool written = fd >= 0 && writeRanges(fd, job.patches, job.bytes.data(), durable);
+    if (fd >= 0) ::close(fd);
+    if (!written) {
+        std::cerr << "Error: Unable to write to file: " << filename << "\n";
+    }
+    return written;
+#else
+    return false;
+#endif
+}
+
+#ifdef JXSL_POSIX_IO
+bool JXSL::writeRanges(const int fd, const std::span<const FlushJob::Patch> ranges, const char* bytes,
+                       const bool durable) const {
+    if (!io) {
+        bool written = true;
+        for (const FlushJob::Patch& range : ranges) {
+            written = written && writeAt(fd, bytes + range.from, range.length, range.offset);
+        }
+        return written && (!durable || fdatasync(fd) == 0);
+    }
+
+    // every range goes to the kernel in one submission; the data sync is queued once they have all completed
+    struct Pending {
+        std::future<int64_t> result;
+        const char* data;
+        size_t length;
+        size_t offset;
+    };
+    std::vector<Pending> pending;
+    for (const FlushJob::Patch& range : ranges) {
+        for (size_t done = 0; done < range.length; done += AsyncIo::CHUNK) {
+            const size_t length = std::min(AsyncIo::CHUNK, range.length - done);
+            const char* data = bytes + range.from + done;
+            pending.push_back({io->write(fd, data, length, range.offset + done), data, length, range.offset + done});
+        }
+    }
+    io->submit();
+    bool written = true;
+    for (Pending& write : pending) {
+        const int64_t result = write.result.get();
+        const size_t done = result > 0 ? static_cast<size_t>(result) : 0;
+        written = written && result >= 0 && writeAt(fd, write.data + done, write.length - done, write.offset + done);
+    }
+    if (written && durable) {
+        std::future<int64_t> synced = io->dataSync(fd);
+        io->submit();
+        written = synced.get() == 0;
+    }
+    return written;
+}
+#endif
+
+bool JXSL::planPatches() {
+#ifdef JXSL_POSIX_IO
+    if (compressed || !disk.known || disk.rewriteNeeded) return false; // a container cannot be patched
+
+    // patches are collected in the job first, so that falling back leaves the file untouched
+    std::pmr::string& bytes = job.bytes;
+    const auto blank = [&](const uint32_t begin, const uint32_t end) {
+        job.patches.push_back({begin, bytes.size(), end - begin});
+        bytes.append(end - begin, ' ');
+        disk.slackBytes += end - begin;
+    };
+    for (const auto& [begin, end] : disk.blankRanges) blank(begin, end);
+
+    std::pmr::string tail(resource); // new members, written over the closing brace or root end tag
+    for (const SourceString& changedKey : disk.changedKeys) {
+        const auto it = data.find(changedKey);
+        if (it == data.end() || !it->second.changed) continue; // deleted again, or listed twice
+        const SourceString& key = it->first;
+        Entry& entry = it->second;
+        entry.changed = false;
+
+        const size_t from = bytes.size();
+        appendValue(bytes, key, entry.value.view());
+        const size_t length = bytes.size() - from;
+        if (entry.onDisk && entry.begin == NO_RANGE) return false; // somewhere in the file, but not known where
+        if (entry.begin != NO_RANGE && length <= entry.end - entry.valueAt) {
+            // same place: pad the rest of the old member with whitespace between the value and the next separator
+            bytes.append(entry.end - entry.valueAt - length, ' ');
+            job.patches.push_back({entry.valueAt, from, entry.end - entry.valueAt});
+            continue;
+        }
+        bytes.resize(from);
+        if (entry.begin != NO_RANGE) { // grown: the member moves to the end of the document
+            if (isJson && entry.firstOnDisk) return false;
+            key.makeOwned(resource); // the key may be a view into the bytes blanked out now
+            blank(entry.begin, entry.end);
+        }
+
+        const size_t begin = disk.closeAt + tail.size();
+        if (isJson) {
+            tail += disk.hasMembers ? ",\n    \"" : "\n    \"";
+            tail += key.view();
+            tail += "\": ";
+            entry.valueAt = static_cast<uint32_t>(disk.closeAt + tail.size());
+            tail += '"';
+            tail += entry.value.view();
+            tail += '"';
+            entry.firstOnDisk = !disk.hasMembers;
+        } else {
+            tail += "    <";
+            tail += key.view();
+            tail += '>';
+            entry.valueAt = static_cast<uint32_t>(disk.closeAt + tail.size());
+            tail += entry.value.view();
+            tail += "</";
+            tail += key.view();
+            tail += '>';
+        }
+        entry.begin = static_cast<uint32_t>(begin);
+        entry.end = static_cast<uint32_t>(disk.closeAt + tail.size());
+        if (!isJson) tail += '\n';
+        entry.onDisk = true;
+        disk.hasMembers = true;
+    }
+    if (disk.slackBytes > (disk.closeAt + tail.size()) / 2) return false; // mostly blank: compact with a rewrite
+    if (static_cast<uint64_t>(disk.closeAt) + tail.size() + disk.closeTag.size() >= NO_RANGE) return false;
+
+    if (!tail.empty()) {
+        // the appended members overwrite the end of the document, which the lazy cursor has not read yet
+        materializeAll();
+        tail += isJson ? std::string_view("\n}") : std::string_view(disk.closeTag);
+        job.patches.push_back({disk.closeAt, bytes.size(), tail.size()});
+        bytes += tail;
+        disk.closeAt += static_cast<uint32_t>(tail.size() - (isJson ? 1 : disk.closeTag.size()));
+    }
+    disk.changedKeys.clear();
+    disk.blankRanges.clear();
+    return true;
+#else
+    return false;
+#endif
+}
+
+void JXSL::markChanged(const SourceString& key, Entry& entry) {
+    if (entry.changed) return;
+    entry.changed = true;
+    disk.changedKeys.emplace_back(key.view(), true, resource);
+}
+
+void JXSL::locate(Entry& entry, const std::string_view text, const size_t keyAt, const size_t valueAt) const {
+    entry.begin = NO_RANGE;
+    if (text.size() >= NO_RANGE) return;
+    const size_t valueEnd = valueAt + entry.value.size();
+    if (isJson) {
+        if (keyAt < 2) return;
+        size_t before = keyAt - 2; // skip the opening quote of the key
+        while (before > 0 && isSpace(text[before])) --before;
+        const bool quoted = entry.type == NodeType::String && text[valueAt - 1] == '"';
+        const size_t padded = padding(text, valueEnd + (quoted ? 1 : 0));
+        size_t after = padded;
+        while (after < text.size() && isSpace(text[after])) ++after;
+        if (after >= text.size() || (text[after] != ',' && text[after] != '}')) return;
+        if (text[before] == ',') {
+            entry.begin = static_cast<uint32_t>(before); // the member owns the comma in front of it
+            entry.firstOnDisk = false;
+        } else if (text[before] == '{') {
+            entry.begin = static_cast<uint32_t>(before + 1);
+            entry.firstOnDisk = true;
+        } else {
+            return;
+        }
+        entry.valueAt = static_cast<uint32_t>(quoted ? valueAt - 1 : valueAt);
+        entry.end = static_cast<uint32_t>(padded);
+    } else {
+        if (entry.value.size() == 0 && (valueAt == 0 || text[valueAt - 1] != '>')) return; // self-closing element
+        const size_t closeEnd = text.find('>', valueEnd);
+        const size_t next = closeEnd == std::string_view::npos ? closeEnd : text.find('<', closeEnd);
+        if (next == std::string_view::npos || keyAt == 0) return;
+        entry.begin = static_cast<uint32_t>(keyAt - 1);
+        entry.valueAt = static_cast<uint32_t>(valueAt);
+        entry.end = static_cast<uint32_t>(padding(text, closeEnd + 1));
+    }
+}
+
+void JXSL::locateClose(const std::string_view text) {
+    const size_t close = isJson ? text.rfind('}') : text.rfind("</");
+    if (close == std::string_view::npos || text.size() >= NO_RANGE) return;
+    disk.closeAt = static_cast<uint32_t>(close);
+    if (!isJson) {
+        const size_t closeEnd = text.find('>', close);
+        if (closeEnd == std::string_view::npos) return;
+        disk.closeTag = text.substr(close, closeEnd + 1 - close);
+    }
+    disk.known = true;
 }
 
 // file operations
 bool JXSL::createFile(const std::string& format) {
-    std::ofstream file(filename);
+    std::ofstream file(filename, compressed ? std::ios::out | std::ios::binary : std::ios::out);
     if (!file.is_open()) {
         std::cerr << "Error: Unable to create file: " << filename << "\n";
         return false;
     }
 
+    std::string_view empty;
     if (format == "JSON") {
-        file << "{}";
+        empty = "{}";
     } else if (format == "XML") {
-        file << "<root></root>";
+        empty = "<root></root>";
     } else {
         std::cerr << "Error: Unsupported file format: " << format << "\n";
         return false;
     }
+    if (compressed) { // the container records the format, so the file name does not have to
+        isJson = format == "JSON";
+        std::pmr::string packed(resource);
+        CompressedFile::pack(empty, {}, isJson, packed);
+        file.write(packed.data(), static_cast<std::streamsize>(packed.size()));
+    } else {
+        file << empty;
+    }
     return true;
 }
 
-std::string JXSL::readFile() const {
-    std::ifstream file(filename);
-    if (!file.is_open()) {
+bool JXSL::readFile(const bool eager) {
+    // parsers work on the mapped bytes directly: no stream buffer and no intermediate string copies. A mapping shows
+    // what other writers put into the file later, so it outlives the load only with zeroCopy; a lazy load reads its
+    // source until the last member is found and gets a private copy otherwise
+    const bool map = memoryMap && !io && (zeroCopy || eager);
+    const bool opened = map ? mapped.open(filename, eager) : mapped.load(filename, io);
+    if (!opened) {
         std::cerr << "Error: Unable to open file: " << filename << "\n";
-        return {};
     }
+    return opened;
+}
 
-    std::ostringstream buffer;
-    buffer << file.rdbuf();
-    return buffer.str();
+bool JXSL::openContainer(const bool lazy) {
+    compressed = true; // and stays so on every flush
+    if (!container.open(mapped.view())) {
+        std::cerr << "Error: Corrupt compressed file: " << filename << "\n";
+        mapped.close();
+        return false;
+    }
+    isJson = container.isJson();
+    if (lazy) { // blocks are decompressed when a key is looked for in them
+        blockRead.assign(container.blockCount(), false);
+        blocksLeft = container.blockCount();
+        return true;
+    }
+    std::pmr::string text(resource);
+    const bool read = container.readAll(text);
+    container.close();
+    if (!read) {
+        std::cerr << "Error: Corrupt compressed file: " << filename << "\n";
+        mapped.close();
+        return false;
+    }
+    mapped.exchange(text); // parsed, and viewed by the entries, like the contents of a plain file
+    return true;
 }
 
-void JXSL::writeFile(const std::string& content) const {
-    std::ofstream file(filename, std::ios::trunc);
+bool JXSL::writeFile(const std::string_view content) const {
+#ifdef JXSL_POSIX_IO
+    // the new contents go to a sibling file that replaces the old one in a single rename: a crash leaves either the
+    // old or the new document, never a truncated one
+    const std::string temporary = filename + ".tmp";
+    const int fd = ::open(temporary.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        std::cerr << "Error: Unable to write to file: " << temporary << "\n";
+        return false;
+    }
+    struct stat info {};
+    if (stat(filename.c_str(), &info) == 0) {
+        fchmod(fd, info.st_mode & 07777); // keep the permissions of the file being replaced
+    }
+#ifdef __linux__
+    if (!content.empty()) {
+        fallocate(fd, 0, 0, static_cast<off_t>(content.size())); // the size is known: one extent, no growth on the way
+    }
+#endif
+    // the data has to be on disk before the rename is, or a crash could leave an empty file under the old name
+    const FlushJob::Patch whole{0, 0, content.size()};
+    bool written = writeRanges(fd, {&whole, 1}, content.data(), true);
+    written = ::close(fd) == 0 && written;
+    if (!written || std::rename(temporary.c_str(), filename.c_str()) != 0) {
+        ::unlink(temporary.c_str());
+        std::cerr << "Error: Unable to write to file: " << filename << "\n";
+        return false;
+    }
+    return true;
+#else
+    std::ofstream file(filename, compressed ? std::ios::trunc | std::ios::binary : std::ios::trunc);
     if (!file.is_open()) {
         std::cerr << "Error: Unable to write to file: " << filename << "\n";
-        return;
+        return false;
     }
     file << content;
+    file.close();
+    if (file.fail()) {
+        std::cerr << "Error: Unable to write to file: " << filename << "\n";
+        return false;
+    }
+    return true;
+#endif
 }
 
 // Core functionalities
 bool JXSL::findKeys(std::vector<std::string>& keys) const {
+    std::lock_guard<std::mutex> lock(stateMutex);
+    materializeAll();
     keys.reserve(data.size());
     for (const auto& [key, _] : data) {
-        keys.push_back(key);
+        keys.emplace_back(key.view());
     }
     return !keys.empty();
 }
 
 bool JXSL::iterateKeys() const {
+    std::lock_guard<std::mutex> lock(stateMutex);
+    materializeAll();
     if (data.empty()) {
         std::cout << "No keys available.\n";
         return false;
     }
     for (const auto& [key, _] : data) {
-        std::cout << "Key: " << key << "\n";
+        std::cout << "Key: " << key.view() << "\n";
     }
     return true;
 }
 
 bool JXSL::readData(const std::string& key, std::string& value) const {
-    const auto it = data.find(key);
+    std::lock_guard<std::mutex> lock(stateMutex);
+    auto it = data.find(SourceString(key));
+    if (it == data.end() && lazyPending()) {
+        materialize(key);
+        it = data.find(SourceString(key)); // materializing may have grown the table: the old iterator is stale
+    }
     if (it != data.end()) {
-        value = it->second;
+        value = it->second.value.view();
         return true;
     }
     return false;
 }
 
 bool JXSL::addData(const std::string& key, const std::string& value) {
-    if (data.find(key) != data.end()) {
+    std::unique_lock<std::mutex> lock(stateMutex);
+    materializeAll(); // the key may appear anywhere in a lazily loaded file
+    if (data.find(SourceString(key)) != data.end()) {
         std::cerr << "Error: Key already exists: " << key << "\n";
         return false;
     }
 
-    data[key] = value;
-    pendingChanges++;
-
-    if (pendingChanges >= FLUSH_THRESHOLD) {
-        flushToFile();
-    }
-    return true;
+    logChange(WalOp::Put, key, value);
+    applyPut(key, value);
+    recordChange(lock, key.size() + value.size());
+    return commitLog(lock);
 }
 
 bool JXSL::editData(const std::string& key, const std::string& newValue) {
-    auto it = data.find(key);
+    std::unique_lock<std::mutex> lock(stateMutex);
+    auto it = data.find(SourceString(key));
+    if (it == data.end() && lazyPending()) {
+        materialize(key);
+        it = data.find(SourceString(key)); // materializing may have grown the table: the old iterator is stale
+    }
     if (it == data.end()) {
         std::cerr << "Error: Key not found: " << key << "\n";
         return false;
     }
 
-    it->second = newValue;
-    pendingChanges++;
+    if (writeThrough(it->first, it->second, newValue)) return true;
+    logChange(WalOp::Put, key, newValue);
+    applyPut(key, newValue);
+    recordChange(lock, key.size() + newValue.size());
+    return commitLog(lock);
+}
 
-    if (pendingChanges >= FLUSH_THRESHOLD) {
-        flushToFile();
-    }
+bool JXSL::writeThrough(const SourceString& key, Entry& entry, const std::string_view value) {
+#ifdef JXSL_POSIX_IO
+    // only where the layout describes the file as it is: no flush writing a new one, no earlier edit of this member
+    // still waiting; the log keeps the file untouched between checkpoints
+    if (!patchInPlace || compressed || wal.isOpen() || writing || !disk.known || entry.changed || entry.begin == NO_RANGE) return false;
+    if (!fileUnchanged()) return false; // the offsets belong to an older version of the file: the next flush rewrites it
+    output.clear();
+    appendValue(output, key, value);
+    const size_t room = entry.end - entry.valueAt;
+    if (output.size() > room) return false;
+    output.append(room - output.size(), ' '); // the rest of the old member becomes whitespace before the separator
+
+    const int fd = ::open(filename.c_str(), O_WRONLY);
+    const FlushJob::Patch patch{entry.valueAt, 0, room};
+    const bool written = fd >= 0 && writeRanges(fd, {&patch, 1}, output.data(), false);
+    if (fd >= 0) ::close(fd);
+    if (!written) return false; // the edit is deferred like any other
+    statFile(disk.stamp);
+    stats.writesInPlace++;
+    stats.bytesChanged += key.size() + value.size();
+    stats.bytesWritten += room;
+    entry.value = SourceString(value, true, resource);
+    entry.type = NodeType::String;
+    treeStale = true;
     return true;
+#else
+    (void)key, (void)entry, (void)value;
+    return false;
+#endif
+}
+
+void JXSL::appendValue(std::pmr::string& out, const SourceString& key, const std::string_view value) const {
+    if (isJson) {
+        out += '"';
+        out += value;
+        out += '"';
+    } else {
+        out += value;
+        out += "</";
+        out += key.view();
+        out += '>';
+    }
 }
 
 bool JXSL::deleteData(const std::string& key) {
-    if (data.erase(key) == 0) {
+    std::unique_lock<std::mutex> lock(stateMutex);
+    if (lazyPending() && data.find(SourceString(key)) == data.end()) {
+        materialize(key);
+    }
+    if (data.find(SourceString(key)) == data.end()) {
         std::cerr << "Error: Key not found: " << key << "\n";
         return false;
     }
 
-    pendingChanges++;
+    logChange(WalOp::Delete, key, {});
+    applyDelete(key);
+    recordChange(lock, key.size());
+    return commitLog(lock);
+}
 
-    if (pendingChanges >= FLUSH_THRESHOLD) {
-        flushToFile();
+void JXSL::logChange(const WalOp op, const std::string_view key, const std::string_view value) {
+    if (wal.isOpen() && !wal.append(op, key, value)) {
+        std::cerr << "Error: Change not logged for key: " << key << "\n";
     }
-    return true;
+}
+
+bool JXSL::commitLog(std::unique_lock<std::mutex>& lock) {
+    if (!wal.isOpen()) return true;
+    if (lock.owns_lock()) lock.unlock(); // other threads go on changing data and join the next commit
+    if (wal.commit()) return true;
+    std::cerr << "Error: Change not durable in the log: " << filename << "\n";
+    return false;
+}
+
+void JXSL::applyPut(const std::string_view key, const std::string_view value) {
+    auto it = data.find(SourceString(key));
+    if (it == data.end()) {
+        it = data.emplace(SourceString(key, true, resource), Entry{}).first; // added entries own their bytes
+    }
+    it->second.value = SourceString(value, true, resource); // copy on write: the source text is left as it is
+    it->second.type = NodeType::String;
+    markChanged(it->first, it->second);
+    treeStale = true;
+}
+
+void JXSL::applyDelete(const std::string_view key) {
+    const auto it = data.find(SourceString(key));
+    if (it == data.end()) return;
+
+    const Entry& entry = it->second;
+    if (entry.onDisk) {
+        // blanking the first JSON member would leave its successor with a leading comma
+        if (entry.begin == NO_RANGE || (isJson && entry.firstOnDisk)) {
+            disk.rewriteNeeded = true;
+        } else {
+            disk.blankRanges.emplace_back(entry.begin, entry.end);
+        }
+    }
+    data.erase(SourceString(key));
+    treeStale = true;
 }
 
 // JSON/XML Parsing and Conversion
-void JXSL::parseJson(const std::string& content) {
+void JXSL::parseJson(const std::string_view content) {
     data.clear();
-    const size_t start = content.find('{');
-    const size_t end = content.find('}');
-    if (start == std::string::npos || end == std::string::npos) return;
+    if (content.find('{') == std::string_view::npos) return;
 
-    std::string body = content.substr(start + 1, end - start - 1);
-    std::istringstream ss(body);
-    std::string line;
-    while (std::getline(ss, line, ',')) {
-        const size_t colon = line.find(':');
-        if (colon != std::string::npos) {
-            std::string key = line.substr(0, colon);
-            std::string value = line.substr(colon + 1);
-            trimQuotes(key);
-            trimQuotes(value);
-            data[key] = value;
-        }
+    // the tree is built in one pass over the structural index: commas and colons inside strings are never split on
+    if (!tree.parseJson(content, false) || tree.root()->type != NodeType::Object) {
+        std::cerr << "Error: Malformed JSON in file: " << filename << "\n";
+        tree.clear();
+        mapped.close();
+        return;
     }
+    loadMembers();
 }
 
-void JXSL::parseXml(const std::string& content) {
+void JXSL::parseXml(const std::string_view content) {
     data.clear();
-    const size_t start = content.find("<root>");
-    const size_t end = content.find("</root>");
-    if (start == std::string::npos || end == std::string::npos) return;
+    if (content.find('<') == std::string_view::npos) return;
+
+    // single scan with the tokenizer: tags and text are views into the mapped content
+    if (!tree.parseXml(content, false)) {
+        std::cerr << "Error: Malformed XML in file: " << filename << "\n";
+        tree.clear();
+        mapped.close();
+        return;
+    }
+    loadMembers();
+}
 
-    std::string body = content.substr(start + 6, end - start - 6);
-    std::istringstream ss(body);
-    std::string line;
-    while (std::getline(ss, line, '>')) {
-        const size_t closeTag = line.find('<');
-        if (closeTag != std::string::npos) {
-            std::string key = line.substr(0, closeTag);
-            std::string value = stripXmlTags(line, key);
-            data[key] = value;
+void JXSL::loadMembers() {
+    const DocumentNode* root = tree.root();
+    const std::string_view text = mapped.view();
+    data.reserve(root->childCount);
+    for (const DocumentNode* member = root->firstChild; member; member = member->next) {
+        // with zeroCopy the entries are views into the mapped text: no allocation per key or value
+        const NodeType type = isJson ? member->type : NodeType::String;
+        const auto [it, inserted] = data.try_emplace(SourceString(member->key, !zeroCopy, resource),
+                                                     Entry{SourceString(member->text, !zeroCopy, resource), type});
+        if (!inserted) continue;
+        it->second.onDisk = true;
+        if (member->text.data()) {
+            locate(it->second, text, member->key.data() - text.data(), member->text.data() - text.data());
         }
     }
+    locateClose(text);
+    disk.hasMembers = root->childCount > 0;
+    if (!zeroCopy) { // everything is copied: the source and the tree pointing into it can go
+        tree.clear();
+        mapped.close();
+        treeStale = true;
+    }
 }
 
-std::string JXSL::toJson() const {
-    std::ostringstream ss;
-    ss << "{\n";
-    for (auto it = data.begin(); it != data.end(); ++it) {
-        ss << "    \"" << it->first << "\": \"" << it->second << "\"";
-        if (std::next(it) != data.end()) ss << ",";
-        ss << "\n";
+size_t JXSL::serializedSize() const {
+    std::lock_guard<std::mutex> lock(stateMutex);
+    return measure();
+}
+
+size_t JXSL::measure() const {
+    materializeAll();
+    size_t size = isJson ? 3 : 14; // "{\n}" or "<root>\n</root>"
+    for (const auto& [key, entry] : data) {
+        if (isJson) { // |    "key": "value",\n|
+            size += 12 + key.size() + entry.value.size() - (entry.type == NodeType::String ? 0 : 2);
+        } else { // |    <key>value</key>\n|
+            size += 10 + 2 * key.size() + entry.value.size();
+        }
     }
-    ss << "}";
-    return ss.str();
+    if (isJson && !data.empty()) --size; // no comma after the last member
+    return size;
 }
 
-std::string JXSL::toXml() const {
-    std::ostringstream ss;
-    ss << "<root>\n";
-    for (const auto& [key, value] : data) {
-        ss << "    <" << key << ">" << value << "</" << key << ">\n";
+size_t JXSL::serializeTo(const std::span<char> buffer) const {
+    std::lock_guard<std::mutex> lock(stateMutex);
+    const size_t size = measure();
+    if (buffer.size() < size) return 0;
+    if (isJson) {
+        writeJson(buffer.data(), nullptr);
+    } else {
+        writeXml(buffer.data(), nullptr);
     }
-    ss << "</root>";
-    return ss.str();
+    return size;
 }
 
-// Utility
-void JXSL::trimQuotes(std::string& str) {
-    str.erase(remove(str.begin(), str.end(), '"'), str.end());
-    str.erase(0, str.find_first_not_of(" \t\n"));
-    str.erase(str.find_last_not_of(" \t\n") + 1);
+std::string_view JXSL::serialize(std::pmr::string& target, std::pmr::vector<size_t>* offsets) const {
+    // one exactly sized buffer filled with memcpy: no stream machinery and no copy of the finished text
+    target.resize(measure());
+    if (offsets) {
+        offsets->clear();
+        offsets->reserve(2 * data.size());
+    }
+    if (isJson) {
+        writeJson(target.data(), offsets);
+    } else {
+        writeXml(target.data(), offsets);
+    }
+    return target;
+}
+
+char* JXSL::writeJson(char* out, std::pmr::vector<size_t>* offsets) const {
+    char* const begin = out;
+    out = put(out, "{\n");
+    size_t remaining = data.size();
+    for (const auto& [key, entry] : data) {
+        out = put(out, "    \"");
+        if (offsets) offsets->push_back(out - begin);
+        out = put(out, key.view());
+        const bool quoted = entry.type == NodeType::String;
+        out = put(out, quoted ? "\": \"" : "\": ");
+        if (offsets) offsets->push_back(out - begin);
+        out = put(out, entry.value.view());
+        if (quoted) *out++ = '"';
+        if (--remaining > 0) *out++ = ',';
+        *out++ = '\n';
+    }
+    *out++ = '}';
+    return out;
 }
 
-std::string JXSL::stripXmlTags(const std::string& line, const std::string& key) {
-    return line.substr(key.length() + 1);
+char* JXSL::writeXml(char* out, std::pmr::vector<size_t>* offsets) const {
+    char* const begin = out;
+    out = put(out, "<root>\n");
+    for (const auto& [key, entry] : data) {
+        out = put(out, "    <");
+        if (offsets) offsets->push_back(out - begin);
+        out = put(out, key.view());
+        *out++ = '>';
+        if (offsets) offsets->push_back(out - begin);
+        out = put(out, entry.value.view());
+        out = put(out, "</");
+        out = put(out, key.view());
+        out = put(out, ">\n");
+    }
+    out = put(out, "</root>");
+    return out;
 }
 
+void JXSL::rebaseEntries(const std::pmr::vector<size_t>& offsets) {
+    // same iteration order as the serialization that produced the offsets; nothing reads the old text here
+    const char* text = mapped.view().data();
+    size_t i = 0;
+    for (auto& [key, entry] : data) {
+        key.rebase(text + offsets[i++]);
+        entry.value.rebase(text + offsets[i++]);
+    }
+}
+
+// Lazy loading
+bool JXSL::materializeNext(std::string_view& key) const {
+    if (!cursor) return false;
+
+    std::string_view value;
+    NodeType type = NodeType::String;
+    if (!cursor->next(key, value, type)) {
+        if (cursor->failed()) {
+            std::cerr << "Error: Malformed " << (isJson ? "JSON" : "XML") << " in file: " << filename << "\n";
+        }
+        cursor.reset();
+        if (!zeroCopy) mapped.close(); // every entry is materialized and owns its bytes now
+        return false;
+    }
+    const auto [it, inserted] =
+        data.try_emplace(SourceString(key, !zeroCopy, resource), Entry{SourceString(value, !zeroCopy, resource), type});
+    if (inserted) {
+        const std::string_view text = mapped.view();
+        it->second.onDisk = true;
+        if (value.data()) locate(it->second, text, key.data() - text.data(), value.data() - text.data());
+    }
+    return true;
+}
+
+bool JXSL::materialize(const std::string_view key) const {
+    // the filters rule out most blocks: only those that may hold the key are decompressed
+    for (size_t block = 0; block < blockRead.size() && blocksLeft > 0; ++block) {
+        if (blockRead[block] || !container.mayContain(block, key)) continue;
+        materializeBlock(block);
+        if (data.find(SourceString(key)) != data.end()) return true;
+    }
+    std::string_view found;
+    while (materializeNext(found)) {
+        if (found == key) return true;
+    }
+    return false;
+}
+
+void JXSL::materializeAll() const {
+    for (size_t block = 0; block < blockRead.size() && blocksLeft > 0; ++block) {
+        if (!blockRead[block]) materializeBlock(block);
+    }
+    if (blocksOutOfOrder && blocksLeft == 0) restoreFileOrder();
+    std::string_view found;
+    while (materializeNext(found)) {}
+}
+
+bool JXSL::materializeBlock(const size_t block) const {
+    std::pmr::string text(resource);
+    bool read = container.readBlock(block, text);
+
+    // the block is scanned as a document of its own: the text in front of the first block's members and behind the
+    // last block's is dropped, and so is the comma after the block's last JSON member
+    std::string_view body = text;
+    if (block == 0) {
+        const size_t open = body.find(isJson ? '{' : '>');
+        body.remove_prefix(open == std::string_view::npos ? body.size() : open + 1);
+    }
+    if (block + 1 == blockRead.size()) {
+        body = body.substr(0, isJson ? body.rfind('}') : body.rfind("</"));
+    }
+    while (!body.empty() && isSpace(body.back())) body.remove_suffix(1);
+    if (isJson && !body.empty() && body.back() == ',') body.remove_suffix(1);
+    std::pmr::string members(isJson ? "{" : "<root>", resource);
+    members += body;
+    members += isJson ? "}" : "</root>";
+
+    if (std::find(blockRead.begin(), blockRead.begin() + static_cast<std::ptrdiff_t>(block), false) !=
+        blockRead.begin() + static_cast<std::ptrdiff_t>(block)) {
+        blocksOutOfOrder = true; // an earlier block has not been read yet
+    }
+    // the scanned text is temporary: these entries own their bytes
+    LazyCursor scan(members, isJson);
+    std::string_view key;
+    std::string_view value;
+    NodeType type = NodeType::String;
+    while (scan.next(key, value, type)) {
+        const auto [it, inserted] =
+            data.try_emplace(SourceString(key, true, resource), Entry{SourceString(value, true, resource), type});
+        if (!inserted) continue;
+        it->second.onDisk = true;
+        it->second.block = static_cast<uint32_t>(block);
+    }
+    read = read && !scan.failed();
+    if (!read) {
+        std::cerr << "Error: Corrupt compressed file: " << filename << "\n";
+    }
+    blockRead[block] = true;
+    if (--blocksLeft == 0) { // nothing views the compressed bytes any more
+        container.close();
+        mapped.close();
+    }
+    return read;
+}
+
+void JXSL::restoreFileOrder() const {
+    // iteration order is insertion order: the entries are inserted again, sorted by the block they came from
+    std::pmr::vector<std::pair<SourceString, Entry>> entries(resource);
+    entries.reserve(data.size());
+    for (auto& item : data) entries.push_back(std::move(item));
+    data.clear();
+    std::stable_sort(entries.begin(), entries.end(),
+                     [](const auto& a, const auto& b) { return a.second.block < b.second.block; });
+    data.reserve(entries.size());
+    for (auto& [key, entry] : entries) data.try_emplace(std::move(key), std::move(entry));
+    blocksOutOfOrder = false;
+}
+
+// Utility
 void JXSL::displayData() const {
-    std::cout << (isJson ? toJson() : toXml()) << "\n";
+    std::lock_guard<std::mutex> lock(stateMutex);
+    std::cout << serialize(output) << "\n";
+}
+
+const DocumentNode* JXSL::documentRoot() {
+    std::lock_guard<std::mutex> lock(stateMutex);
+    if (treeStale) {
+        // rebuild from the current state; arena teardown makes the old tree free to drop
+        if (isJson) {
+            tree.parseJson(serialize(output));
+        } else {
+            tree.parseXml(serialize(output));
+        }
+        treeStale = false;
+    }
+    return tree.root();
 }
 
@@ -3,18 +3,100 @@
 #ifndef JXSL_LIB_CPP_H
 #define JXSL_LIB_CPP_H
 
+#include "jxsl_async_io.h"
+#include "jxsl_compressed_file.h"
+#include "jxsl_document.h"
+#include "jxsl_flat_map.h"
+#include "jxsl_lazy_cursor.h"
+#include "jxsl_mapped_file.h"
+#include "jxsl_source_string.h"
+#include "jxsl_wal.h"
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <memory_resource>
+#include <mutex>
+#include <span>
 #include <string>
-#include <unordered_map>
+#include <string_view>
+#include <thread>
 #include <vector>
 #include <iostream>
 
+enum class LoadMode {
+    Eager, // read and parse the whole file in the constructor
+    Lazy   // only map the file; entries are located and materialized on first access
+};
+
+// When pending changes are written to the file. Every limit set to 0 is off; the first one reached starts a flush
+struct FlushPolicy {
+    int maxPendingChanges = 10;
+    size_t maxDirtyBytes = 1 << 20; // keys and values changed since the last flush
+    // age of the oldest pending change; checked on every change, and by the flusher while idle with backgroundFlush
+    std::chrono::milliseconds maxAge{1000};
+    bool flushOnDestruction = true;
+    bool manualOnly = false; // only flushToFile() and sync() write, whatever the limits say
+};
+
+// per-instance counters, e.g. write amplification = bytesWritten / bytesChanged
+struct FlushStats {
+    uint64_t flushes = 0;
+    uint64_t rewrites = 0; // flushes that wrote the whole file (the rest patched only the changed members)
+    uint64_t failedFlushes = 0;
+    uint64_t changesFlushed = 0;
+    uint64_t writesInPlace = 0; // edits written straight into the file (JxslOptions::patchInPlace)
+    uint64_t bytesChanged = 0;
+    uint64_t bytesWritten = 0;
+    std::chrono::nanoseconds flushTime{0}; // spent in flushes, planning and writing
+    std::chrono::nanoseconds longestFlush{0};
+};
+
+struct JxslOptions {
+    LoadMode loadMode = LoadMode::Eager;
+    // parse the file through a read-only mapping; false reads it into memory instead. Without zeroCopy the mapping is
+    // dropped once everything is copied out of it, and a lazy load, which keeps reading, gets a copy of the file
+    bool memoryMap = true;
+    // unmodified entries view the loaded text instead of owning a copy. With memoryMap that text is the live mapping,
+    // so the file must not be changed in place by anyone else while this JXSL is open (C library edits that fit are)
+    bool zeroCopy = false;
+    // the entry table, owned keys and values, the read buffer and serialized output are allocated from this resource
+    // (e.g. a monotonic_buffer_resource per request); nullptr uses std::pmr::get_default_resource(). Must outlive the JXSL
+    std::pmr::memory_resource* memoryResource = nullptr;
+    FlushPolicy flushPolicy;
+    // every change is appended to <file>.wal before it is applied, and replayed from there after a crash; the file
+    // itself is only updated at checkpoints, which are the flushes of flushPolicy (the log makes far larger limits safe).
+    // A change is durable in the log when the call that made it returns; changes made by concurrent threads share one
+    // write + fdatasync of the log
+    bool writeAheadLog = false;
+    bool backgroundFlush = false; // a worker thread flushes instead of the mutating call that reaches a limit
+    // loads (in place of the mapping) and flush writes go through this io_uring; one instance can serve many
+    // documents and must outlive them
+    AsyncIo* asyncIo = nullptr;
+    // an edit that fits where the old value is in the file is written there at once (padded with whitespace) instead
+    // of waiting for a flush; not with the log, which keeps the file unchanged between checkpoints
+    bool patchInPlace = true;
+    // flushes write a block-compressed container (as they always do for .jxz files and files that already are one);
+    // every flush then rewrites the file, and a lazy load decompresses only the blocks that may hold a requested key
+    bool compress = false;
+};
+
+// All member functions may be called from several threads; a flush holds the lock only while it takes its snapshot
 class JXSL {
 public:
-    explicit JXSL(const std::string& filename);
+    explicit JXSL(const std::string& filename, const JxslOptions& options = {});
+    ~JXSL(); // flushes what is still pending unless the policy says otherwise
+    JXSL(const JXSL&) = delete;
+    JXSL& operator=(const JXSL&) = delete;
 
     // file operations
     bool createFile(const std::string& format);
-    void flushToFile(); // rewrite file with all changes
+    // rewrite file with all changes. If another writer changed the file since it was read, it is rewritten with the
+    // contents as loaded plus these changes: the last writer wins
+    void flushToFile();
+    void sync(); // barrier: every change made before the call is in the file and on stable storage
+    void setFlushPolicy(const FlushPolicy& policy);
+    FlushStats flushStats() const;
 
     // core functionalities
     bool findKeys(std::vector<std::string>& keys) const;
@@ -24,25 +106,141 @@ public:
     bool editData(const std::string& key, const std::string& newValue);
     bool deleteData(const std::string& key);
     void displayData() const;
+    size_t serializedSize() const; // exact size of the JSON/XML text flushToFile() would write
+    size_t serializeTo(std::span<char> buffer) const; // bytes written; 0 if the buffer is smaller than serializedSize()
+    const DocumentNode* documentRoot(); // typed tree of the whole document, valid until the next change
 
 private:
     std::string filename;
-    bool isJson; // determining the file type
-    std::unordered_map<std::string, std::string> data; // saving a key-value
+    bool isJson; // determining the file type (by extension, or from the container header)
+    bool compressed; // the file is written as a CompressedFile container
+    bool memoryMap; // read through mmap instead of a plain read
+    bool zeroCopy; // unmodified entries point into 'mapped'
+    std::pmr::memory_resource* resource;
+    AsyncIo* io;
+    static constexpr uint32_t NO_RANGE = UINT32_MAX;
+    struct Entry {
+        SourceString value;
+        NodeType type = NodeType::String; // JSON: only strings are quoted; other scalars and objects/arrays (raw text) are not
+        bool changed = false; // added or edited since the last flush (and listed in disk.changedKeys)
+        bool onDisk = false; // present in the file (at [begin, end) unless that could not be determined)
+        bool firstOnDisk = false; // JSON: no comma in front, so the member cannot be blanked without shifting the layout
+        uint32_t begin = NO_RANGE; // the member occupies [begin, end) of the file, its value (or opening quote) at valueAt
+        uint32_t valueAt = 0;
+        uint32_t end = 0;
+        uint32_t block = NO_RANGE; // lazy mode on a container: the block the member was read from (NO_RANGE: added)
+    };
+    // identity of a version of the file: another writer (e.g. the C library) changes at least one of these
+    struct FileStamp {
+        uint64_t size = 0;
+        uint64_t inode = 0;
+        int64_t modified = 0; // nanoseconds
+        int64_t changed = 0;
+        bool operator==(const FileStamp&) const = default;
+    };
+    // what the file on disk looks like, so that a flush can patch only what changed
+    struct DiskLayout {
+        explicit DiskLayout(std::pmr::memory_resource* resource) : closeTag(resource), changedKeys(resource), blankRanges(resource) {}
+        bool known = false; // the offsets below describe the current file
+        FileStamp stamp; // of the file they were taken from; patches go only into that very file
+        bool rewriteNeeded = false; // a change that cannot be patched in place
+        bool hasMembers = false;
+        uint32_t closeAt = 0; // the closing '}' or root end tag: new members are written here
+        std::pmr::string closeTag; // XML: the root end tag as found in the file
+        size_t slackBytes = 0; // bytes blanked out by deleted or moved members
+        std::pmr::vector<SourceString> changedKeys;
+        std::pmr::vector<std::pair<uint32_t, uint32_t>> blankRanges; // members of deleted keys
+    };
+    // saving a key-value (filled on demand in lazy mode); iterated in file order followed by added keys, so a rewrite
+    // leaves every member where the previous flush put it
+    mutable FlatHashMap<SourceString, Entry, SourceStringHash> data;
+    mutable std::pmr::string output; // serialization buffer, reused across flushes (swapped with the source buffer)
+    mutable std::pmr::vector<size_t> entryOffsets; // where the last serialization put every key and value
+    mutable MappedFile mapped; // file contents: parsed in place, kept while entries, the tree or the lazy cursor point into it
+    mutable std::unique_ptr<LazyCursor> cursor; // lazy mode: position of the next entry not materialized yet
+    mutable CompressedFile container; // lazy mode on a compressed file: block index of the bytes in 'mapped'
+    mutable std::pmr::vector<bool> blockRead; // its blocks already materialized
+    mutable size_t blocksLeft; // not materialized yet
+    mutable bool blocksOutOfOrder; // a lookup read a block before an earlier one: entries are not in file order
     int pendingChanges; // change counter for deferred data recording
+    FlushPolicy policy;
+    FlushStats stats;
+    Document tree; // arena-allocated document model; top-level members are mirrored into data
+    bool treeStale; // data was changed after the tree was built
+    mutable DiskLayout disk;
+    WriteAheadLog wal; // open only with JxslOptions::writeAheadLog
+    // what a flush writes: prepared under the state lock, written without it
+    struct FlushJob {
+        explicit FlushJob(std::pmr::memory_resource* resource)
+            : patches(resource), bytes(resource), members(resource), packed(resource) {}
+        struct Patch {
+            size_t offset;
+            size_t from; // bytes in 'bytes'
+            size_t length;
+        };
+        bool rewrite = false;
+        std::string_view content; // rewrite: the whole document, in 'mapped' or in 'bytes'
+        std::pmr::vector<Patch> patches;
+        std::pmr::string bytes;
+        uint64_t logEnd = 0; // the log records the flush covers
+        std::pmr::vector<CompressedFile::Member> members; // compressed rewrite: where blocks may be cut
+        std::pmr::string packed; // the container, built while writing
+    };
+    FlushJob job; // guarded by flushMutex
+    size_t dirtyBytes; // keys and values changed since the last flush
+    std::chrono::steady_clock::time_point firstChangeAt; // of the pending changes
+    bool writing; // a flush job is being written: the layout already describes the file it produces
+    mutable std::mutex stateMutex; // guards every member above except 'job'
+    std::mutex flushMutex; // one flush at a time; always taken before stateMutex
+    std::condition_variable flushWake;
+    bool stopFlusher;
+    std::thread flusher; // running only with JxslOptions::backgroundFlush
+    bool patchInPlace;
     // internal file utilities
-    std::string readFile() const;
-    void writeFile(const std::string& content) const;
+    bool readFile(bool eager); // map (or read) the whole file into 'mapped'; eager: it is parsed right away
+    bool openContainer(bool lazy); // 'mapped' holds a container: index it (lazy) or replace it by the text
+    bool writeFile(std::string_view content) const;
+    void flush(bool durable);
+    bool planPatches(); // only the changed members; false if the whole file has to be rewritten
+    void planRewrite();
+    bool writeJob(bool durable); // unlocked: only touches the job and reads the bytes it points to
+    bool writeRanges(int fd, std::span<const FlushJob::Patch> ranges, const char* bytes, bool durable) const;
+    bool syncFile() const; // make the file contents durable
+    bool statFile(FileStamp& stamp) const;
+    bool fileUnchanged() const; // the file is still the one the layout was taken from
+    void replayLog(); // open the log and apply the changes it holds
+    void recordChange(std::unique_lock<std::mutex>& lock, size_t bytes); // counts it and flushes when a trigger is reached
+    bool flushDue() const; // a limit of the policy is reached
+    void runFlusher();
+    bool writeThrough(const SourceString& key, Entry& entry, std::string_view value); // false: defer the edit
+    void appendValue(std::pmr::string& out, const SourceString& key, std::string_view value) const; // as in the file
+    void markChanged(const SourceString& key, Entry& entry);
+    void logChange(WalOp op, std::string_view key, std::string_view value);
+    bool commitLog(std::unique_lock<std::mutex>& lock); // waits (unlocked) until the logged changes are durable
+    void applyPut(std::string_view key, std::string_view value); // add or replace in memory
+    void applyDelete(std::string_view key);
+    // record where a member whose key and value start at the given offsets lies in 'text'
+    void locate(Entry& entry, std::string_view text, size_t keyAt, size_t valueAt) const;
+    void locateClose(std::string_view text); // closing brace or root end tag of the file contents
 
     // parsing and serialization
-    void parseJson(const std::string& content);
-    void parseXml(const std::string& content);
-    std::string toJson() const; // convert data to JSON
-    std::string toXml() const; // convert data to XML
-
-    // helper functions
-    static void trimQuotes(std::string& str); // trim redundant quotes
-    static std::string stripXmlTags(const std::string& line, const std::string& key); // extract data between tags
+    void parseJson(std::string_view content);
+    void parseXml(std::string_view content);
+    size_t measure() const; // serializedSize() without the lock
+    // offsets (optional) receive the positions of every key and value in the output, in iteration order
+    std::string_view serialize(std::pmr::string& target, std::pmr::vector<size_t>* offsets = nullptr) const;
+    char* writeJson(char* out, std::pmr::vector<size_t>* offsets) const; // exactly serializedSize() bytes, returns the end
+    char* writeXml(char* out, std::pmr::vector<size_t>* offsets) const;
+    void loadMembers(); // fill data from the top-level members of the tree
+    void rebaseEntries(const std::pmr::vector<size_t>& offsets); // point every entry into the text now held by 'mapped'
+
+    // lazy mode
+    bool materializeNext(std::string_view& key) const; // false once the whole file has been scanned
+    bool materialize(std::string_view key) const; // scan until the key is found
+    void materializeAll() const;
+    bool lazyPending() const { return cursor || blocksLeft > 0; } // entries left to materialize
+    bool materializeBlock(size_t block) const; // every member of one block of the container
+    void restoreFileOrder() const; // sort the entries by block, added ones last
 };
 
 #endif // JXSL_LIB_CPP_H
@@ -0,0 +1,131 @@
+// JSON/XML Simple Library (JXSL). Read-only view of a whole file: memory-mapped on POSIX systems (with madvise hints),
+// or read into memory with a single read.
+#include "jxsl_mapped_file.h"
+#include "jxsl_async_io.h"
+#include <algorithm>
+#include <fstream>
+#include <future>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define JXSL_POSIX_IO 1
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::MappedFile(std::pmr::memory_resource* resource) : buffer(resource) {}
+
+MappedFile::~MappedFile() {
+    close();
+}
+
+bool MappedFile::open(const std::string& path, const bool prefetch) {
+#ifdef JXSL_POSIX_IO
+    close();
+    const int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+
+    struct stat info {};
+    if (fstat(fd, &info) != 0) {
+        ::close(fd);
+        return false;
+    }
+    size = static_cast<size_t>(info.st_size);
+    if (size > 0) {
+        void* address = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (address == MAP_FAILED) {
+            ::close(fd);
+            size = 0;
+            return false;
+        }
+        // parsers scan front to back: aggressive readahead, pages behind the scan can be dropped early
+        madvise(address, size, MADV_SEQUENTIAL);
+        if (prefetch) madvise(address, size, MADV_WILLNEED);
+        data = static_cast<const char*>(address);
+        mapped = true;
+    }
+    ::close(fd); // the mapping stays valid without the descriptor
+    opened = true;
+    return true;
+#else
+    (void)prefetch;
+    return load(path);
+#endif
+}
+
+bool MappedFile::load(const std::string& path, AsyncIo* io) {
+    close();
+#ifdef JXSL_POSIX_IO
+    if (io) {
+        const int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) return false;
+        struct stat info {};
+        if (fstat(fd, &info) != 0) {
+            ::close(fd);
+            return false;
+        }
+        buffer.resize(static_cast<size_t>(info.st_size));
+        // the chunks are read in parallel; documents sharing the ring are reaped by the same wait
+        std::vector<std::future<int64_t>> chunks;
+        for (size_t offset = 0; offset < buffer.size(); offset += AsyncIo::CHUNK) {
+            chunks.push_back(io->read(fd, buffer.data() + offset, std::min(AsyncIo::CHUNK, buffer.size() - offset), offset));
+        }
+        io->submit();
+        bool complete = true;
+        for (size_t i = 0; i < chunks.size(); ++i) {
+            const size_t offset = i * AsyncIo::CHUNK;
+            size_t done = 0;
+            int64_t result = chunks[i].get();
+            const size_t length = std::min(AsyncIo::CHUNK, buffer.size() - offset);
+            while (complete && result > 0 && (done += static_cast<size_t>(result)) < length) { // short read
+                result = pread(fd, buffer.data() + offset + done, length - done, static_cast<off_t>(offset + done));
+            }
+            complete = complete && done == length;
+        }
+        ::close(fd);
+        if (!complete) {
+            buffer.clear();
+            return false;
+        }
+        data = buffer.data();
+        size = buffer.size();
+        opened = true;
+        return true;
+    }
+#endif
+    (void)io;
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    if (!file.is_open()) return false;
+    size = static_cast<size_t>(file.tellg());
+    buffer.resize(size);
+    file.seekg(0);
+    file.read(buffer.data(), static_cast<std::streamsize>(size));
+    data = buffer.data();
+    opened = true;
+    return true;
+}
+
+void MappedFile::exchange(std::pmr::string& contents) {
+#ifdef JXSL_POSIX_IO
+    if (mapped) munmap(const_cast<char*>(data), size);
+#endif
+    mapped = false;
+    buffer.swap(contents);
+    data = buffer.data();
+    size = buffer.size();
+    opened = true;
+}
+
+void MappedFile::close() {
+#ifdef JXSL_POSIX_IO
+    if (mapped) munmap(const_cast<char*>(data), size);
+#endif
+    buffer.clear();
+    buffer.shrink_to_fit();
+    data = nullptr;
+    size = 0;
+    opened = false;
+    mapped = false;
+}
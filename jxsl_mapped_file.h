@@ -0,0 +1,41 @@
+// JSON/XML Simple Library (JXSL). Read-only view of a whole file: memory-mapped on POSIX systems (with madvise hints),
+// or read into memory with a single read.
+
+#ifndef JXSL_MAPPED_FILE_H
+#define JXSL_MAPPED_FILE_H
+
+#include <cstddef>
+#include <memory_resource>
+#include <string>
+#include <string_view>
+
+class AsyncIo;
+
+class MappedFile {
+public:
+    // the buffer for read or adopted contents comes from the resource
+    explicit MappedFile(std::pmr::memory_resource* resource = std::pmr::get_default_resource());
+    ~MappedFile();
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    bool open(const std::string& path, bool prefetch = false); // map; prefetch starts reading the whole file ahead
+    // read into an owned buffer instead of mapping; with io all chunks are requested in one submission
+    bool load(const std::string& path, AsyncIo* io = nullptr);
+    // take over text already in memory (e.g. what was just written to the file); 'contents' gets the previous buffer
+    // back for reuse and must use the same memory resource
+    void exchange(std::pmr::string& contents);
+    void close();
+    bool isOpen() const { return opened; }
+    bool isMapped() const { return mapped; } // the view shows the file itself, including later changes by others
+    std::string_view view() const { return {data, size}; }
+
+private:
+    const char* data = nullptr;
+    size_t size = 0;
+    bool opened = false;
+    bool mapped = false; // data points into a mapping rather than into buffer
+    std::pmr::string buffer;
+};
+
+#endif // JXSL_MAPPED_FILE_H
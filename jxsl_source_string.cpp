@@ -0,0 +1,61 @@
+// JSON/XML Simple Library (JXSL). Borrowed-or-owned string used for the key-value entries.
+#include "jxsl_source_string.h"
+#include <cstring>
+#include <utility>
+
+SourceString::SourceString(const std::string_view text, const bool owned, std::pmr::memory_resource* resource)
+    : data(text.data()), length(text.size()) {
+    if (owned) {
+        char* block = static_cast<char*>(resource->allocate(HEADER + text.size() + 1, alignof(std::pmr::memory_resource*)));
+        std::memcpy(block, &resource, HEADER);
+        char* copy = block + HEADER;
+        std::memcpy(copy, text.data(), text.size());
+        copy[text.size()] = '\0';
+        data = copy;
+        length |= OWNED;
+    } else if (text.data() == nullptr) {
+        data = "";
+    }
+}
+
+SourceString::SourceString(const SourceString& other)
+    : SourceString(other.view(), other.owned(), other.owned() ? resourceOf(other.data) : nullptr) {}
+
+SourceString::SourceString(SourceString&& other) noexcept : data(other.data), length(other.length) {
+    other.data = "";
+    other.length = 0;
+}
+
+SourceString& SourceString::operator=(SourceString other) noexcept {
+    std::swap(data, other.data);
+    std::swap(length, other.length);
+    return *this;
+}
+
+SourceString::~SourceString() {
+    release();
+}
+
+void SourceString::rebase(const char* text) const {
+    release();
+    data = text;
+    length &= ~OWNED;
+}
+
+void SourceString::makeOwned(std::pmr::memory_resource* resource) const {
+    if (owned()) return;
+    SourceString copy(view(), true, resource);
+    std::swap(data, copy.data);
+    std::swap(length, copy.length);
+}
+
+std::pmr::memory_resource* SourceString::resourceOf(const char* bytes) {
+    std::pmr::memory_resource* resource;
+    std::memcpy(&resource, bytes - HEADER, HEADER);
+    return resource;
+}
+
+void SourceString::release() const {
+    if (!owned()) return;
+    resourceOf(data)->deallocate(const_cast<char*>(data) - HEADER, HEADER + size() + 1, alignof(std::pmr::memory_resource*));
+}
@@ -0,0 +1,50 @@
+// JSON/XML Simple Library (JXSL). String that either points into a source buffer kept alive elsewhere or owns a copy of its
+// bytes: parsed entries stay views into the file until they are modified.
+
+#ifndef JXSL_SOURCE_STRING_H
+#define JXSL_SOURCE_STRING_H
+
+#include <cstddef>
+#include <functional>
+#include <memory_resource>
+#include <string_view>
+
+class SourceString {
+public:
+    SourceString() = default;
+    // owned = false: only the pointer is kept, the bytes must outlive the string (or be rebased before they go away);
+    // owned copies are allocated from the resource, which must outlive them
+    explicit SourceString(std::string_view text, bool owned = false,
+                          std::pmr::memory_resource* resource = std::pmr::get_default_resource());
+    SourceString(const SourceString& other);
+    SourceString(SourceString&& other) noexcept;
+    SourceString& operator=(SourceString other) noexcept;
+    ~SourceString();
+
+    std::string_view view() const { return {data, length & ~OWNED}; }
+    size_t size() const { return length & ~OWNED; }
+    bool owned() const { return (length & OWNED) != 0; }
+    // point at an equal copy of the bytes elsewhere, releasing an owned copy; const because the bytes (and so the hash)
+    // stay the same, which lets map keys be moved onto a new buffer in place
+    void rebase(const char* text) const;
+    void makeOwned(std::pmr::memory_resource* resource) const; // copy borrowed bytes before their source changes
+
+    bool operator==(const SourceString& other) const { return view() == other.view(); }
+
+private:
+    static constexpr size_t OWNED = ~(~size_t(0) >> 1); // top bit of length: 16 bytes per string instead of 24
+    // an owned copy is preceded by the resource it came from, so the string itself stays two words
+    static constexpr size_t HEADER = sizeof(std::pmr::memory_resource*);
+
+    static std::pmr::memory_resource* resourceOf(const char* bytes);
+    void release() const;
+
+    mutable const char* data = "";
+    mutable size_t length = 0;
+};
+
+struct SourceStringHash {
+    size_t operator()(const SourceString& text) const { return std::hash<std::string_view>{}(text.view()); }
+};
+
+#endif // JXSL_SOURCE_STRING_H
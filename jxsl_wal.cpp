@@ -0,0 +1,263 @@
+// JSON/XML Simple Library (JXSL). Write-ahead log: changes are encoded as compact binary records, and the records of
+// concurrent commits are made durable together with one fdatasync.
+#include "jxsl_wal.h"
+#include <array>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define JXSL_POSIX_IO 1
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+constexpr char MAGIC[8] = {'J', 'X', 'S', 'L', 'W', 'A', 'L', '1'};
+constexpr size_t HEADER_SIZE = sizeof(MAGIC);
+constexpr size_t RECORD_HEADER = 4 + 1 + 4 + 4; // crc, op, key size, value size
+
+// CRC-32C (Castagnoli), reflected, one table lookup per byte
+uint32_t crc32c(const char* data, const size_t size) {
+    static const std::array<uint32_t, 256> table = [] {
+        std::array<uint32_t, 256> result{};
+        for (uint32_t i = 0; i < 256; ++i) {
+            uint32_t crc = i;
+            for (int bit = 0; bit < 8; ++bit) crc = (crc >> 1) ^ (0x82F63B78u & (0u - (crc & 1)));
+            result[i] = crc;
+        }
+        return result;
+    }();
+    uint32_t crc = ~0u;
+    for (size_t i = 0; i < size; ++i) {
+        crc = (crc >> 8) ^ table[(crc ^ static_cast<uint8_t>(data[i])) & 0xFF];
+    }
+    return ~crc;
+}
+
+void putU32(char* out, const uint32_t value) {
+    for (int i = 0; i < 4; ++i) out[i] = static_cast<char>(value >> (8 * i));
+}
+
+uint32_t getU32(const char* in) {
+    uint32_t value = 0;
+    for (int i = 0; i < 4; ++i) value |= static_cast<uint32_t>(static_cast<uint8_t>(in[i])) << (8 * i);
+    return value;
+}
+
+#ifdef JXSL_POSIX_IO
+bool writeAll(const int fd, const char* data, size_t size) {
+    while (size > 0) {
+        const ssize_t written = ::write(fd, data, size);
+        if (written <= 0) return false;
+        data += written;
+        size -= static_cast<size_t>(written);
+    }
+    return true;
+}
+#endif
+
+} // namespace
+
+WriteAheadLog::WriteAheadLog(std::pmr::memory_resource* resource) : batch(resource), writing(resource) {}
+
+WriteAheadLog::~WriteAheadLog() {
+    close();
+}
+
+bool WriteAheadLog::open(const std::string& logPath) {
+#ifdef JXSL_POSIX_IO
+    close();
+    std::lock_guard<std::mutex> lock(mutex);
+    fd = ::open(logPath.c_str(), O_RDWR | O_CREAT, 0644);
+    if (fd < 0) {
+        std::cerr << "Error: Unable to open log: " << logPath << "\n";
+        return false;
+    }
+    struct stat info {};
+    fstat(fd, &info);
+    path = logPath;
+    fileSize = static_cast<uint64_t>(info.st_size);
+    return true;
+#else
+    std::cerr << "Error: Write-ahead log is not supported on this platform: " << logPath << "\n";
+    return false;
+#endif
+}
+
+bool WriteAheadLog::isOpen() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return fd >= 0;
+}
+
+bool WriteAheadLog::replay(const std::function<void(WalOp op, std::string_view key, std::string_view value)>& fn) {
+#ifdef JXSL_POSIX_IO
+    if (fd < 0 || fileSize == 0) return true;
+    std::vector<char> contents(fileSize);
+    if (pread(fd, contents.data(), contents.size(), 0) != static_cast<ssize_t>(contents.size())) return false;
+    if (contents.size() < HEADER_SIZE || std::memcmp(contents.data(), MAGIC, HEADER_SIZE) != 0) {
+        std::cerr << "Error: Not a JXSL log, ignoring it: " << path << "\n";
+        return reset();
+    }
+
+    size_t pos = HEADER_SIZE;
+    while (contents.size() - pos >= RECORD_HEADER) {
+        const char* record = contents.data() + pos;
+        const uint32_t keySize = getU32(record + 5);
+        const uint32_t valueSize = getU32(record + 9);
+        const uint64_t size = RECORD_HEADER + static_cast<uint64_t>(keySize) + valueSize;
+        if (size > contents.size() - pos || getU32(record) != crc32c(record + 4, size - 4)) break;
+        const auto op = static_cast<WalOp>(record[4]);
+        if (op != WalOp::Put && op != WalOp::Delete) break;
+        fn(op, {record + RECORD_HEADER, keySize}, {record + RECORD_HEADER + keySize, valueSize});
+        pos += size;
+    }
+    if (pos < contents.size()) { // torn write: later appends must not end up behind garbage
+        if (ftruncate(fd, static_cast<off_t>(pos)) != 0) return false;
+        fileSize = pos;
+    }
+    return true;
+#else
+    (void)fn;
+    return false;
+#endif
+}
+
+bool WriteAheadLog::append(const WalOp op, const std::string_view key, const std::string_view value) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (fd < 0) return false;
+    const size_t start = batch.size();
+    batch.resize(start + RECORD_HEADER + key.size() + value.size());
+    char* record = batch.data() + start;
+    record[4] = static_cast<char>(op);
+    putU32(record + 5, static_cast<uint32_t>(key.size()));
+    putU32(record + 9, static_cast<uint32_t>(value.size()));
+    if (!key.empty()) std::memcpy(record + RECORD_HEADER, key.data(), key.size());
+    if (!value.empty()) std::memcpy(record + RECORD_HEADER + key.size(), value.data(), value.size());
+    putU32(record, crc32c(record + 4, batch.size() - start - 4));
+    appended++;
+    return true;
+}
+
+bool WriteAheadLog::commit() {
+#ifdef JXSL_POSIX_IO
+    std::unique_lock<std::mutex> lock(mutex);
+    const uint64_t target = appended;
+    while (fd >= 0 && durable < target) {
+        if (committing) { // a leader is writing: its sync may cover our records, otherwise the next round will
+            committed.wait(lock);
+            continue;
+        }
+        // leader: one write and one fdatasync for everything appended so far, by any thread
+        committing = true;
+        writing.swap(batch);
+        const uint64_t upTo = appended;
+        const uint64_t offset = fileSize;
+        const int logFd = fd;
+        lock.unlock();
+        bool written = offset != 0 || pwrite(logFd, MAGIC, HEADER_SIZE, 0) == static_cast<ssize_t>(HEADER_SIZE);
+        const uint64_t start = offset != 0 ? offset : HEADER_SIZE;
+        written = written && lseek(logFd, static_cast<off_t>(start), SEEK_SET) >= 0 &&
+                  writeAll(logFd, writing.data(), writing.size()) && fdatasync(logFd) == 0;
+        lock.lock();
+        committing = false;
+        if (written) {
+            fileSize = start + writing.size();
+            durable = upTo;
+        } else {
+            batch.insert(0, writing); // in front of what was appended meanwhile; the next commit tries again
+        }
+        writing.clear();
+        committed.notify_all();
+        if (!written) {
+            std::cerr << "Error: Unable to write to log: " << path << "\n";
+            return false;
+        }
+    }
+    return true;
+#else
+    return false;
+#endif
+}
+
+void WriteAheadLog::waitForCommit(std::unique_lock<std::mutex>& lock) {
+    committed.wait(lock, [this] { return !committing; });
+}
+
+bool WriteAheadLog::reset() {
+    std::unique_lock<std::mutex> lock(mutex);
+    waitForCommit(lock);
+    return truncate();
+}
+
+bool WriteAheadLog::truncate() {
+#ifdef JXSL_POSIX_IO
+    if (fd < 0) return false;
+    // only the records on disk are checkpointed: the batch holds changes made after the checkpoint was taken (while the
+    // flush wrote the document), which the next commit writes to the empty log
+    if (ftruncate(fd, 0) != 0 || fdatasync(fd) != 0) {
+        std::cerr << "Error: Unable to write to log: " << path << "\n";
+        return false;
+    }
+    fileSize = 0;
+    return true;
+#else
+    return false;
+#endif
+}
+
+uint64_t WriteAheadLog::size() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return fileSize;
+}
+
+bool WriteAheadLog::discardUpTo(const uint64_t offset) {
+#ifdef JXSL_POSIX_IO
+    std::unique_lock<std::mutex> lock(mutex); // the log is replaced: no leader may be writing to the old one
+    waitForCommit(lock);
+    if (fd < 0) return false;
+    if (offset >= fileSize) return truncate();
+
+    // the remaining records go to a new log that replaces the old one in a single rename: a crash leaves either log
+    // whole, never checkpointed records behind newer ones
+    std::vector<char> contents(HEADER_SIZE + (fileSize - offset));
+    std::memcpy(contents.data(), MAGIC, HEADER_SIZE);
+    const std::string next = path + ".tmp";
+    bool written = pread(fd, contents.data() + HEADER_SIZE, contents.size() - HEADER_SIZE, static_cast<off_t>(offset)) ==
+                   static_cast<ssize_t>(contents.size() - HEADER_SIZE);
+    const int nextFd = written ? ::open(next.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644) : -1;
+    written = nextFd >= 0 && writeAll(nextFd, contents.data(), contents.size()) && fdatasync(nextFd) == 0 &&
+              std::rename(next.c_str(), path.c_str()) == 0;
+    if (!written) {
+        if (nextFd >= 0) {
+            ::close(nextFd);
+            ::unlink(next.c_str());
+        }
+        std::cerr << "Error: Unable to write to log: " << path << "\n";
+        return false;
+    }
+    ::close(fd);
+    fd = nextFd;
+    fileSize = contents.size();
+    return true;
+#else
+    (void)offset;
+    return false;
+#endif
+}
+
+void WriteAheadLog::close() {
+#ifdef JXSL_POSIX_IO
+    commit();
+    std::unique_lock<std::mutex> lock(mutex);
+    waitForCommit(lock);
+    if (fd < 0) return;
+    ::close(fd);
+    fd = -1;
+    batch.clear(); // only left by a failed commit, which reported it
+    appended = durable = 0;
+#endif
+}
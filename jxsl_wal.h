@@ -0,0 +1,57 @@
+// JSON/XML Simple Library (JXSL). Append-only write-ahead log of key-value changes, kept in a sidecar file next to the
+// document until the next checkpoint.
+
+#ifndef JXSL_WAL_H
+#define JXSL_WAL_H
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory_resource>
+#include <mutex>
+#include <string>
+#include <string_view>
+
+enum class WalOp : uint8_t { Put = 1, Delete = 2 };
+
+// Records are [crc32c][op][key size][value size][key][value] (little-endian), after an 8-byte file header. A record
+// that is cut short or fails its checksum marks the end of the log: everything from there on is dropped.
+// Appends only queue a record; commit() returns once every record appended before it is durable. Threads committing at
+// the same time share one write + fdatasync: the first becomes the leader and writes what all of them appended, the
+// others wait for it (group commit).
+class WriteAheadLog {
+public:
+    explicit WriteAheadLog(std::pmr::memory_resource* resource = std::pmr::get_default_resource());
+    ~WriteAheadLog(); // commits what is still batched
+    WriteAheadLog(const WriteAheadLog&) = delete;
+    WriteAheadLog& operator=(const WriteAheadLog&) = delete;
+
+    bool open(const std::string& path);
+    bool isOpen() const;
+    // calls fn for every intact record in order; a torn tail left by a crash is cut off
+    bool replay(const std::function<void(WalOp op, std::string_view key, std::string_view value)>& fn);
+    bool append(WalOp op, std::string_view key, std::string_view value = {}); // queued: durable after the next commit()
+    bool commit(); // make every record appended so far durable
+    bool reset(); // checkpoint: the document holds every committed change, so the log starts over (batched records stay)
+    // checkpoint of the records up to 'offset' (a size() taken earlier); records appended since then are kept
+    bool discardUpTo(uint64_t offset);
+    uint64_t size() const; // committed bytes
+    void close();
+
+private:
+    int fd = -1;
+    std::string path;
+    uint64_t fileSize = 0;
+    std::pmr::string batch; // records not written yet
+    std::pmr::string writing; // records the leader is writing
+    uint64_t appended = 0; // records appended since the log was opened
+    uint64_t durable = 0; // of those, records written and synced
+    bool committing = false; // a leader is writing 'writing' with the lock released
+    mutable std::mutex mutex;
+    std::condition_variable committed; // a leader finished
+    void waitForCommit(std::unique_lock<std::mutex>& lock); // until no leader is writing
+    bool truncate(); // reset() with the lock held
+};
+
+#endif // JXSL_WAL_H
@@ -0,0 +1,199 @@
+// JSON/XML Simple Library (JXSL). StAX-style pull reader for XML: the unread part of the input is kept in one buffer that is
+// compacted and refilled in place, so memory use is fixed no matter how large the document is.
+#include "jxsl_xml_stream.h"
+#include "jxsl_xml_tokenizer.h"
+#include <algorithm>
+#include <cstring>
+
+namespace {
+
+bool isNameEnd(const char c) {
+    return c == '>' || c == '/' || c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+bool isWhitespaceOnly(const std::string_view text) {
+    return text.find_first_not_of(" \t\r\n") == std::string_view::npos;
+}
+
+} // namespace
+
+XmlPullReader::XmlPullReader(std::istream& input, const size_t bufferSize)
+    : input(&input), buffer(bufferSize), begin(0), end(0), consumed(0), eof(false), pendingEnd(false), inCdata(false) {}
+
+XmlPullReader::XmlPullReader(const std::string& filename, const size_t bufferSize)
+    : ownedFile(std::make_unique<std::ifstream>(filename, std::ios::binary)), input(ownedFile.get()),
+      buffer(bufferSize), begin(0), end(0), consumed(0), eof(false), pendingEnd(false), inCdata(false) {
+    if (!ownedFile->is_open()) fail("Unable to open file: " + filename);
+}
+
+XmlEvent XmlPullReader::fail(const std::string& message) {
+    if (errorMessage.empty()) errorMessage = message;
+    return XmlEvent::Error;
+}
+
+bool XmlPullReader::fill() {
+    if (eof) return false;
+    if (begin > 0) {
+        std::memmove(buffer.data(), buffer.data() + begin, end - begin);
+        end -= begin;
+        begin = 0;
+    }
+    if (end == buffer.size()) return false; // the window is full: the token is larger than the buffer
+    input->read(buffer.data() + end, static_cast<std::streamsize>(buffer.size() - end));
+    const size_t read = static_cast<size_t>(input->gcount());
+    end += read;
+    if (read == 0) eof = true;
+    return read > 0;
+}
+
+bool XmlPullReader::ensure(const size_t bytes) {
+    while (end - begin < bytes) {
+        if (!fill()) return false;
+    }
+    return true;
+}
+
+size_t XmlPullReader::find(const std::string_view pattern, const size_t from) {
+    while (true) {
+        const size_t found = window().find(pattern, from);
+        if (found != std::string_view::npos) return found;
+        if (!fill()) return std::string_view::npos;
+    }
+}
+
+bool XmlPullReader::skipPast(const std::string_view terminator, size_t from) {
+    while (true) {
+        const size_t found = window().find(terminator, from);
+        if (found != std::string_view::npos) {
+            begin += found + terminator.size();
+            return true;
+        }
+        // drop what was scanned, keeping a possible partial terminator at the end of the window
+        const size_t keep = std::min(end - begin, terminator.size() - 1);
+        begin = end - keep;
+        from = 0;
+        if (!fill()) return false;
+    }
+}
+
+XmlEvent XmlPullReader::cdataText(const size_t from) {
+    const size_t close = find("]]>", from);
+    if (close != std::string_view::npos) {
+        inCdata = false;
+        currentText = window().substr(0, close);
+        consumed = close + 3;
+        return XmlEvent::Text;
+    }
+    if (eof) return fail("Unterminated CDATA section");
+    // the section does not fit: report what is buffered, keeping a possible partial "]]>"
+    inCdata = true;
+    consumed = end - begin - 2;
+    currentText = window().substr(0, consumed);
+    return XmlEvent::Text;
+}
+
+XmlEvent XmlPullReader::next() {
+    begin += consumed;
+    consumed = 0;
+    currentText = {};
+    if (!errorMessage.empty()) return XmlEvent::Error;
+
+    if (pendingEnd) {
+        pendingEnd = false;
+        return XmlEvent::EndElement; // currentName still refers to the self-closing tag
+    }
+
+    if (inCdata) return cdataText(0);
+
+    while (true) {
+        if (!ensure(1)) {
+            if (!openLengths.empty()) return fail("Unexpected end of document");
+            return XmlEvent::EndDocument;
+        }
+
+        if (window()[0] != '<') {
+            // text longer than the buffer is reported in several pieces
+            size_t lt = find("<", 0);
+            if (lt == std::string_view::npos) lt = end - begin;
+            currentText = window().substr(0, lt);
+            consumed = lt;
+            if (openLengths.empty()) { // outside the root element only whitespace is allowed
+                if (!isWhitespaceOnly(currentText)) return fail("Text outside of the root element");
+                begin += consumed;
+                consumed = 0;
+                continue;
+            }
+            return XmlEvent::Text;
+        }
+
+        ensure(9);
+        const std::string_view head = window().substr(0, 9);
+        if (head == "<![CDATA[") {
+            begin += 9;
+            return cdataText(0);
+        }
+        if (head.substr(0, 2) == "<?" || head.substr(0, 2) == "<!") {
+            const std::string_view terminator = head.substr(0, 2) == "<?" ? "?>" : (head.substr(0, 4) == "<!--" ? "-->" : ">");
+            if (!skipPast(terminator, 2)) return fail("Unterminated markup declaration");
+            continue;
+        }
+
+        const size_t gt = find(">", 1);
+        if (gt == std::string_view::npos) return fail("Unterminated tag or tag larger than the buffer");
+        const std::string_view tag = window().substr(0, gt + 1);
+        consumed = gt + 1;
+
+        if (tag[1] == '/') {
+            size_t nameEnd = 2;
+            while (nameEnd < tag.size() && !isNameEnd(tag[nameEnd])) ++nameEnd;
+            currentName = tag.substr(2, nameEnd - 2);
+            if (openLengths.empty()) return fail("Unexpected closing tag");
+            const size_t length = openLengths.back();
+            if (length != currentName.size() ||
+                !XmlTokenizer::tagsEqual(openNames.data() + openNames.size() - length, currentName.data(), length)) {
+                return fail("Closing tag does not match: " + std::string(currentName));
+            }
+            openNames.resize(openNames.size() - length);
+            openLengths.pop_back();
+            return XmlEvent::EndElement;
+        }
+
+        size_t nameEnd = 1;
+        while (nameEnd < tag.size() && !isNameEnd(tag[nameEnd])) ++nameEnd;
+        currentName = tag.substr(1, nameEnd - 1);
+        if (currentName.empty()) return fail("Empty tag name");
+        if (tag[tag.size() - 2] == '/') {
+            pendingEnd = true;
+        } else {
+            openNames.append(currentName);
+            openLengths.push_back(currentName.size());
+        }
+        return XmlEvent::StartElement;
+    }
+}
+
+bool XmlPullReader::nextElement(std::string_view& tag, std::string_view& text) {
+    bool inElement = false; // a start tag was seen and no child element since
+    while (true) {
+        switch (next()) {
+            case XmlEvent::StartElement:
+                elementTag.assign(currentName);
+                elementText.clear();
+                inElement = true;
+                break;
+            case XmlEvent::Text:
+                if (inElement) elementText.append(currentText);
+                break;
+            case XmlEvent::EndElement:
+                if (inElement) {
+                    tag = elementTag;
+                    text = elementText;
+                    return true;
+                }
+                break;
+            case XmlEvent::EndDocument:
+            case XmlEvent::Error:
+                return false;
+        }
+    }
+}
@@ -0,0 +1,59 @@
+// JSON/XML Simple Library (JXSL). StAX-style pull reader for XML: advances one event at a time over a chunked input
+// through a fixed-size buffer.
+
+#ifndef JXSL_XML_STREAM_H
+#define JXSL_XML_STREAM_H
+
+#include <cstddef>
+#include <fstream>
+#include <istream>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+enum class XmlEvent { StartElement, EndElement, Text, EndDocument, Error };
+
+class XmlPullReader {
+public:
+    explicit XmlPullReader(std::istream& input, size_t bufferSize = 64 * 1024);
+    explicit XmlPullReader(const std::string& filename, size_t bufferSize = 64 * 1024);
+
+    // views returned by name() and text() stay valid until the next call
+    XmlEvent next();
+    // next element without child elements (at any depth) with its text; false at the end of the document or on error
+    bool nextElement(std::string_view& tag, std::string_view& text);
+
+    std::string_view name() const { return currentName; }
+    std::string_view text() const { return currentText; }
+    size_t depth() const { return openLengths.size(); }
+    const std::string& error() const { return errorMessage; }
+
+private:
+    std::unique_ptr<std::ifstream> ownedFile;
+    std::istream* input;
+    std::vector<char> buffer; // fixed capacity: tokens larger than the buffer are reported as errors
+    size_t begin;             // unread window is [begin, end)
+    size_t end;
+    size_t consumed;          // bytes of the last event, released on the next call
+    bool eof;
+    bool pendingEnd;          // a self-closing tag still owes its EndElement
+    bool inCdata;             // inside a CDATA section larger than the buffer
+    std::string openNames;    // names of the open elements, concatenated
+    std::vector<size_t> openLengths;
+    std::string_view currentName;
+    std::string_view currentText;
+    std::string elementTag;   // reusable storage for nextElement()
+    std::string elementText;
+    std::string errorMessage;
+
+    std::string_view window() const { return {buffer.data() + begin, end - begin}; }
+    bool fill();                                        // compact the window and read more input
+    bool ensure(size_t bytes);                          // at least 'bytes' in the window unless the input ends
+    size_t find(std::string_view pattern, size_t from); // offset in the window, refilling as needed; npos if absent
+    bool skipPast(std::string_view terminator, size_t from); // discard input up to and including the terminator
+    XmlEvent cdataText(size_t from); // text of a CDATA section whose opening markup is consumed
+    XmlEvent fail(const std::string& message);
+};
+
+#endif // JXSL_XML_STREAM_H
@@ -0,0 +1,158 @@
+// JSON/XML Simple Library (JXSL). Single-pass pointer-based XML tokenizer: one forward scan with memchr, no copies.
+#include "jxsl_xml_tokenizer.h"
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#define JXSL_SSE2 1
+#include <emmintrin.h>
+#endif
+
+namespace {
+
+bool isNameEnd(const char c) {
+    return c == '>' || c == '/' || c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+} // namespace
+
+XmlTokenizer::XmlTokenizer(const std::string_view xml)
+    : xml(xml), pos(0), rootOpened(false), finished(false), malformed(false) {
+    open.reserve(16);
+}
+
+bool XmlTokenizer::tagsEqual(const char* lhs, const char* rhs, size_t length) {
+#ifdef JXSL_SSE2
+    for (; length >= 16; length -= 16, lhs += 16, rhs += 16) {
+        const __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(lhs));
+        const __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(rhs));
+        if (_mm_movemask_epi8(_mm_cmpeq_epi8(a, b)) != 0xFFFF) return false;
+    }
+#endif
+    return std::memcmp(lhs, rhs, length) == 0;
+}
+
+XmlToken XmlTokenizer::error() {
+    pos = xml.size();
+    XmlToken token;
+    token.type = XmlTokenType::Error;
+    return token;
+}
+
+size_t XmlTokenizer::skipPast(const std::string_view terminator) {
+    const size_t found = xml.find(terminator, pos);
+    return found == std::string_view::npos ? found : found + terminator.size();
+}
+
+XmlToken XmlTokenizer::next() {
+    XmlToken token;
+    while (true) {
+        token.begin = pos;
+        if (pos >= xml.size()) {
+            if (!open.empty()) return error(); // unclosed element
+            token.type = XmlTokenType::End;
+            return token;
+        }
+
+        const char* cursor = xml.data() + pos;
+        const size_t remaining = xml.size() - pos;
+        if (*cursor != '<') {
+            const void* lt = std::memchr(cursor, '<', remaining);
+            token.end = lt ? static_cast<size_t>(static_cast<const char*>(lt) - xml.data()) : xml.size();
+            token.type = XmlTokenType::Text;
+            token.text = xml.substr(pos, token.end - pos);
+            pos = token.end;
+            return token;
+        }
+
+        if (remaining > 1 && (cursor[1] == '?' || cursor[1] == '!')) {
+            if (xml.substr(pos, 9) == "<![CDATA[") {
+                const size_t close = xml.find("]]>", pos + 9);
+                if (close == std::string_view::npos) return error();
+                token.type = XmlTokenType::Text;
+                token.text = xml.substr(pos + 9, close - pos - 9);
+                token.end = pos = close + 3;
+                return token;
+            }
+            // declaration, comment or DOCTYPE
+            pos = skipPast(cursor[1] == '?' ? "?>" : (xml.substr(pos, 4) == "<!--" ? "-->" : ">"));
+            if (pos == std::string_view::npos) return error();
+            continue;
+        }
+
+        const void* gt = std::memchr(cursor, '>', remaining);
+        if (!gt) return error();
+        token.end = static_cast<size_t>(static_cast<const char*>(gt) - xml.data()) + 1;
+
+        if (remaining > 1 && cursor[1] == '/') {
+            size_t nameEnd = pos + 2;
+            while (nameEnd < token.end && !isNameEnd(xml[nameEnd])) ++nameEnd;
+            token.type = XmlTokenType::EndTag;
+            token.name = xml.substr(pos + 2, nameEnd - pos - 2);
+            if (open.empty() || open.back().size() != token.name.size() ||
+                !tagsEqual(open.back().data(), token.name.data(), token.name.size())) {
+                return error(); // closing tag does not match the open element
+            }
+            open.pop_back();
+        } else {
+            size_t nameEnd = pos + 1;
+            while (nameEnd < token.end && !isNameEnd(xml[nameEnd])) ++nameEnd;
+            token.type = XmlTokenType::StartTag;
+            token.name = xml.substr(pos + 1, nameEnd - pos - 1);
+            token.selfClosing = xml[token.end - 2] == '/';
+            if (token.name.empty()) return error();
+            if (!token.selfClosing) open.push_back(token.name);
+        }
+        pos = token.end;
+        return token;
+    }
+}
+
+bool XmlTokenizer::nextElement(std::string_view& tag, std::string_view& text) {
+    if (finished) return false;
+    if (!rootOpened) {
+        XmlToken token = next();
+        while (token.type == XmlTokenType::Text) token = next(); // whitespace before the root element
+        if (token.type != XmlTokenType::StartTag) {
+            finished = malformed = true;
+            return false;
+        }
+        rootOpened = true;
+        if (token.selfClosing) { // <root/>
+            finished = true;
+            return false;
+        }
+    }
+
+    size_t contentStart = 0;
+    while (true) {
+        const XmlToken token = next();
+        switch (token.type) {
+            case XmlTokenType::StartTag:
+                if (depth() == (token.selfClosing ? 1 : 2)) { // direct child of the root
+                    tag = token.name;
+                    if (token.selfClosing) {
+                        text = {};
+                        return true;
+                    }
+                    contentStart = token.end;
+                }
+                break;
+            case XmlTokenType::EndTag:
+                if (depth() == 1) {
+                    text = xml.substr(contentStart, token.begin - contentStart);
+                    return true;
+                }
+                if (depth() == 0) { // root element closed
+                    finished = true;
+                    return false;
+                }
+                break;
+            case XmlTokenType::Text:
+                break;
+            case XmlTokenType::End:
+            case XmlTokenType::Error:
+                finished = malformed = true;
+                return false;
+        }
+    }
+}
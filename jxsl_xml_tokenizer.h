@@ -0,0 +1,46 @@
+// JSON/XML Simple Library (JXSL). Single-pass pointer-based XML tokenizer emitting tags and text as views into the buffer.
+
+#ifndef JXSL_XML_TOKENIZER_H
+#define JXSL_XML_TOKENIZER_H
+
+#include <cstddef>
+#include <string_view>
+#include <vector>
+
+enum class XmlTokenType { StartTag, EndTag, Text, End, Error };
+
+struct XmlToken {
+    XmlTokenType type = XmlTokenType::End;
+    std::string_view name; // tag name for StartTag/EndTag
+    std::string_view text; // character data for Text (CDATA sections are reported without the markup)
+    bool selfClosing = false;
+    size_t begin = 0; // token position in the buffer
+    size_t end = 0;
+};
+
+class XmlTokenizer {
+public:
+    explicit XmlTokenizer(std::string_view xml);
+
+    XmlToken next(); // skips declarations, comments and DOCTYPE; closing tags are checked against the open element
+    size_t depth() const { return open.size(); }
+
+    // next child element of the root element: its name and raw content; false at the end of the root or on error
+    bool nextElement(std::string_view& tag, std::string_view& text);
+    bool failed() const { return malformed; }
+
+    static bool tagsEqual(const char* lhs, const char* rhs, size_t length); // vectorized compare
+
+private:
+    std::string_view xml;
+    size_t pos;
+    std::vector<std::string_view> open; // names of the elements that are not closed yet
+    bool rootOpened;
+    bool finished;
+    bool malformed;
+
+    XmlToken error();
+    size_t skipPast(std::string_view terminator); // position after the terminator or npos
+};
+
+#endif // JXSL_XML_TOKENIZER_H
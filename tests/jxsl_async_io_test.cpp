@@ -0,0 +1,169 @@
+// Asynchronous I/O tests: results and errors reach the futures, a full queue submits itself, shutdown waits
+
+#include "jxsl_async_io.h"
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <future>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define JXSL_POSIX_IO 1
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#ifdef __linux__
+#include <dirent.h>
+#endif
+
+namespace {
+
+int failures = 0;
+
+void check(const bool condition, const std::string& what) {
+    if (!condition) {
+        std::cerr << "[FAIL] " << what << "\n";
+        failures++;
+    }
+}
+
+#ifdef JXSL_POSIX_IO
+// many more requests than the queue holds: queueing has to submit (and wait for room) by itself
+void testMoreRequestsThanQueueDepth(AsyncIo& io, const std::string& name) {
+    const std::string filename = "async_io_test.dat";
+    const int fd = ::open(filename.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    check(fd >= 0, name + ": open");
+    constexpr int WRITES = 200;
+    const std::string block = "0123456789";
+    std::vector<std::future<int64_t>> writes;
+    for (int i = 0; i < WRITES; i++) writes.push_back(io.write(fd, block.data(), block.size(), i * block.size()));
+    check(io.submit(), name + ": submit");
+    int64_t written = 0;
+    for (std::future<int64_t>& write : writes) written += write.get();
+    check(written == WRITES * static_cast<int64_t>(block.size()), name + ": bytes written");
+
+    std::future<int64_t> synced = io.dataSync(fd);
+    std::string back(block.size(), '\0');
+    std::future<int64_t> read = io.read(fd, back.data(), back.size(), (WRITES - 1) * block.size());
+    io.submit();
+    check(synced.get() == 0, name + ": data sync");
+    check(read.get() == static_cast<int64_t>(block.size()) && back == block, name + ": read back");
+    ::close(fd);
+    std::remove(filename.c_str());
+}
+
+// a failing operation completes with -errno and leaves the queue usable
+void testErrorsReachTheFuture(AsyncIo& io, const std::string& name) {
+    char buffer[16] = {};
+    std::future<int64_t> bad = io.read(-1, buffer, sizeof(buffer), 0);
+    io.submit();
+    check(bad.get() == -EBADF, name + ": error of a bad descriptor");
+
+    const int fd = ::open("/dev/null", O_WRONLY);
+    std::future<int64_t> good = io.write(fd, buffer, sizeof(buffer), 0);
+    io.submit();
+    check(good.get() == static_cast<int64_t>(sizeof(buffer)), name + ": write after an error");
+    ::close(fd);
+}
+
+// the destructor waits for what is still in flight, without a final submit() by the caller
+void testShutdownWithRequestsInFlight() {
+    const int fd = ::open("/dev/null", O_WRONLY);
+    const std::string data(4096, 'x');
+    std::vector<std::future<int64_t>> writes;
+    {
+        AsyncIo io(8);
+        for (int i = 0; i < 20; i++) writes.push_back(io.write(fd, data.data(), data.size(), 0));
+    }
+    for (std::future<int64_t>& write : writes) {
+        check(write.wait_for(std::chrono::seconds(0)) == std::future_status::ready, "shutdown left a request waiting");
+    }
+    ::close(fd);
+}
+
+#ifdef __linux__
+// the descriptor of the process's io_uring, found by its link in /proc/self/fd; -1 if there is none
+int ringDescriptor() {
+    DIR* directory = opendir("/proc/self/fd");
+    if (!directory) return -1;
+    int ring = -1;
+    while (const dirent* entry = readdir(directory)) {
+        char target[64] = {};
+        const std::string link = std::string("/proc/self/fd/") + entry->d_name;
+        if (readlink(link.c_str(), target, sizeof(target) - 1) > 0 && std::string(target).find("io_uring") != std::string::npos) {
+            ring = std::stoi(entry->d_name);
+        }
+    }
+    closedir(directory);
+    return ring;
+}
+
+// waiting for completions fails (injected by putting another file under the ring's descriptor, so that the next
+// io_uring_enter is refused): a request the kernel already has must not complete while the kernel may still write into
+// its buffer, only when its own completion arrives
+void testWaitFailureKeepsSubmittedRequests() {
+    int first[2];
+    int second[2];
+    check(pipe(first) == 0 && pipe(second) == 0, "wait failure: pipes");
+    {
+        AsyncIo io(8);
+        if (!io.usingRing()) return;
+        const int ring = ringDescriptor();
+        check(ring >= 0, "wait failure: ring descriptor not found");
+        if (ring < 0) return;
+        std::string a(8, '\0');
+        std::string b(8, '\0');
+        std::future<int64_t> readA = io.read(first[0], a.data(), a.size(), 0); // both wait for data in their pipes
+        std::future<int64_t> readB = io.read(second[0], b.data(), b.size(), 0);
+        check(io.submit(), "wait failure: submit");
+
+        const int null = ::open("/dev/null", O_WRONLY);
+        dup2(null, ring); // the reaper waiting in the kernel keeps the ring until its wait returns
+        ::close(null);
+        check(::write(first[1], "first", 5) == 5, "wait failure: write to the first pipe");
+        check(readA.get() == 5 && a.compare(0, 5, "first") == 0, "wait failure: completion before the failure");
+
+        check(readB.wait_for(std::chrono::milliseconds(100)) == std::future_status::timeout,
+              "wait failure: a submitted request completed while the kernel still had its buffer");
+        check(!io.usingRing(), "wait failure: ring not given up");
+        check(::write(second[1], "second", 6) == 6, "wait failure: write to the second pipe");
+        check(readB.wait_for(std::chrono::seconds(5)) == std::future_status::ready && readB.get() == 6 &&
+                  b.compare(0, 6, "second") == 0,
+              "wait failure: submitted request not completed by its own completion");
+
+        const int out = ::open("/dev/null", O_WRONLY);
+        std::future<int64_t> later = io.write(out, a.data(), a.size(), 0);
+        check(later.wait_for(std::chrono::seconds(0)) == std::future_status::ready && later.get() == 8,
+              "wait failure: later operation not run synchronously");
+        ::close(out);
+    } // the destructor leaves the reaper, which has nothing in flight any more
+    for (const int fd : {first[0], first[1], second[0], second[1]}) ::close(fd);
+}
+#endif
+#endif
+
+} // namespace
+
+int main() {
+#ifdef JXSL_POSIX_IO
+    AsyncIo io(4);
+    const std::string name = io.usingRing() ? "io_uring" : "synchronous fallback";
+    std::cout << "Testing " << name << "\n";
+    testMoreRequestsThanQueueDepth(io, name);
+    testErrorsReachTheFuture(io, name);
+    testShutdownWithRequestsInFlight();
+#ifdef __linux__
+    testWaitFailureKeepsSubmittedRequests();
+#endif
+#endif
+
+    if (failures) {
+        std::cerr << failures << " check(s) failed\n";
+        return 1;
+    }
+    std::cout << "All asynchronous I/O tests passed\n";
+    return 0;
+}
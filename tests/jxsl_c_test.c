@@ -0,0 +1,408 @@
+// C library tests: the XML index sidecar, the document handles, key listing and batch deletes
+
+#include "jxsl_lib.h"
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static int failures = 0;
+
+static void check(bool condition, const char* what) {
+    if (!condition) {
+        fprintf(stderr, "[FAIL] %s\n", what);
+        failures++;
+    }
+}
+
+static void write_text(const char* filename, const char* text) {
+    FILE* file = fopen(filename, "w");
+    fputs(text, file);
+    fclose(file);
+}
+
+static void set_mtime(const char* filename, time_t seconds) {
+    struct timespec times[2] = {{seconds, 0}, {seconds, 0}};
+    utimensat(AT_FDCWD, filename, times, 0);
+}
+
+static bool value_is(const char* filename, const char* key, const char* expected) {
+    char value[1024];
+    return read_data(filename, key, value) && strcmp(value, expected) == 0;
+}
+
+// every "k<i>x" of an XML file holds "value<i>"
+static bool xml_values_intact(const char* filename, int count) {
+    char key[32], expected[32];
+    for (int i = 0; i < count; i++) {
+        snprintf(key, sizeof(key), "k%dx", i);
+        snprintf(expected, sizeof(expected), "value%d", i);
+        if (!value_is(filename, key, expected)) return false;
+    }
+    return true;
+}
+
+static void test_xml_index_follows_edits(void) {
+    const char* filename = "c_test_index.xml";
+    unlink(filename);
+    unlink("c_test_index.xml.idx");
+    create_file(filename, "XML");
+    char key[32], value[32];
+    for (int i = 0; i < 40; i++) {
+        snprintf(key, sizeof(key), "k%dx", i);
+        snprintf(value, sizeof(value), "value%d", i);
+        add_data_xml(filename, key, value);
+    }
+    check(access("c_test_index.xml.idx", F_OK) == 0, "the index is written next to the XML file");
+    check(xml_values_intact(filename, 40), "values read through the index");
+
+    // a longer value moves everything behind it: the index shifts those positions instead of being rebuilt
+    check(edit_data_xml(filename, "k3x", "a value much longer than the one it replaces"), "grow a value");
+    check(value_is(filename, "k3x", "a value much longer than the one it replaces"), "grown value");
+    check(value_is(filename, "k2x", "value2") && value_is(filename, "k4x", "value4") &&
+              value_is(filename, "k39x", "value39"), "values before and behind a grown one");
+    check(edit_data_xml(filename, "k3x", "value3"), "shrink a value");
+    check(edit_data_xml(filename, "k39x", "the last value grows too"), "grow the last value");
+    check(edit_data_xml(filename, "k39x", "value39"), "shrink the last value");
+    check(xml_values_intact(filename, 40), "values after growing and shrinking");
+}
+
+static void test_xml_index_rebuilt_when_stale(void) {
+    const char* filename = "c_test_stale.xml";
+    unlink("c_test_stale.xml.idx");
+    write_text(filename, "<?xml version=\"1.0\"?>\n<root>\n    <a>first</a>\n    <b>second</b>\n</root>\n");
+    set_mtime(filename, 1000000000);
+    check(value_is(filename, "a", "first") && value_is(filename, "b", "second"), "values of the original file");
+
+    // same size, other contents and modification time
+    write_text(filename, "<?xml version=\"1.0\"?>\n<root>\n    <b>second</b>\n    <a>first</a>\n</root>\n");
+    set_mtime(filename, 1000000100);
+    check(value_is(filename, "a", "first") && value_is(filename, "b", "second"), "index rebuilt after a change of mtime");
+
+    // other size, same modification time
+    write_text(filename, "<?xml version=\"1.0\"?>\n<root>\n    <a>1</a>\n    <b>22</b>\n    <c>333</c>\n</root>\n");
+    set_mtime(filename, 1000000100);
+    check(value_is(filename, "a", "1") && value_is(filename, "b", "22") && value_is(filename, "c", "333"),
+          "index rebuilt after a change of size");
+
+    // an index that is not one at all
+    write_text("c_test_stale.xml.idx", "garbage");
+    check(value_is(filename, "c", "333"), "index rebuilt over a damaged one");
+    check(!value_is(filename, "d", ""), "a missing key stays missing");
+}
+
+// the reference a handle is checked against: which "k<i>x" keys exist and their values
+#define HANDLE_KEYS 200
+static bool handle_live[HANDLE_KEYS];
+static char handle_values[HANDLE_KEYS][32];
+
+static bool handle_matches(jxsl_doc* doc) {
+    char key[32], value[64];
+    for (int i = 0; i < HANDLE_KEYS; i++) {
+        snprintf(key, sizeof(key), "k%dx", i);
+        bool found = jxsl_read(doc, key, value);
+        if (found != handle_live[i] || (found && strcmp(value, handle_values[i]) != 0)) return false;
+    }
+    return true;
+}
+
+static void test_handle_operations(const char* filename) {
+    unlink(filename);
+    memset(handle_live, 0, sizeof(handle_live));
+    check(jxsl_open(filename, 0) == NULL, "a missing file does not open without JXSL_OPEN_CREATE");
+    jxsl_doc* doc = jxsl_open(filename, JXSL_OPEN_CREATE);
+    check(doc != NULL, "JXSL_OPEN_CREATE creates the document");
+    if (!doc) return;
+
+    // random operations, values growing and shrinking, with the file reopened now and then
+    srand(7);
+    char key[32], value[32];
+    bool agreed = true;
+    for (int step = 0; step < 4000; step++) {
+        int i = rand() % HANDLE_KEYS;
+        snprintf(key, sizeof(key), "k%dx", i);
+        int length = 1 + rand() % 24;
+        for (int c = 0; c < length; c++) value[c] = (char)('a' + rand() % 26);
+        value[length] = '\0';
+        switch (rand() % 4) {
+            case 0:
+                if (handle_live[i]) break;
+                agreed = agreed && jxsl_add(doc, key, value);
+                strcpy(handle_values[i], value);
+                handle_live[i] = true;
+                break;
+            case 1:
+                agreed = agreed && jxsl_edit(doc, key, value) == handle_live[i];
+                if (handle_live[i]) strcpy(handle_values[i], value);
+                break;
+            case 2:
+                agreed = agreed && jxsl_delete(doc, key) == handle_live[i];
+                handle_live[i] = false;
+                break;
+            default:
+                agreed = agreed && jxsl_read(doc, key, value) == handle_live[i];
+                break;
+        }
+        if (step % 500 == 499) {
+            jxsl_close(doc);
+            doc = jxsl_open(filename, 0);
+            if (!doc) break;
+            agreed = agreed && handle_matches(doc);
+        }
+    }
+    check(doc != NULL && agreed && handle_matches(doc), "handle operations follow the reference");
+    if (!doc) return;
+    for (int i = 0; i < HANDLE_KEYS; i++) {
+        snprintf(key, sizeof(key), "k%dx", i);
+        if (handle_live[i]) {
+            check(!jxsl_add(doc, key, "duplicate"), "a key is added only once");
+            break;
+        }
+    }
+
+    // keys are listed in file order: the order they were added in, deleted ones left out
+    int live = 0;
+    for (int i = 0; i < HANDLE_KEYS; i++) live += handle_live[i];
+    key_list keys;
+    check(jxsl_list_keys(doc, &keys) && keys.count == (size_t)live, "every live key is listed");
+    free_key_list(&keys);
+    jxsl_close(doc);
+
+    // the file-based functions read what the handle wrote
+    bool same = true;
+    for (int i = 0; i < HANDLE_KEYS; i++) {
+        snprintf(key, sizeof(key), "k%dx", i);
+        if (handle_live[i]) same = same && value_is(filename, key, handle_values[i]);
+    }
+    check(same, "file-based reads agree with the handle");
+
+    doc = jxsl_open(filename, JXSL_OPEN_READ_ONLY);
+    check(doc != NULL && handle_matches(doc), "a read-only handle reads the same values");
+    check(!jxsl_add(doc, "new", "1") && !jxsl_edit(doc, "k0x", "1") && !jxsl_delete(doc, "k1x"),
+          "a read-only handle refuses changes");
+    check(handle_matches(doc), "refused changes leave the values alone");
+    jxsl_close(doc);
+
+    // emptied and filled again: the document stays well-formed
+    doc = jxsl_open(filename, 0);
+    for (int i = 0; i < HANDLE_KEYS; i++) {
+        snprintf(key, sizeof(key), "k%dx", i);
+        if (handle_live[i]) jxsl_delete(doc, key);
+        handle_live[i] = false;
+    }
+    check(jxsl_list_keys(doc, &keys) && keys.count == 0, "no keys left after deleting them all");
+    free_key_list(&keys);
+    check(jxsl_add(doc, "k0x", "again") && jxsl_add(doc, "k1x", "and again"), "add to an emptied document");
+    check(jxsl_list_keys(doc, &keys) && keys.count == 2 && strcmp(keys.text + keys.offsets[0], "k0x") == 0 &&
+              strcmp(keys.text + keys.offsets[1], "k1x") == 0, "keys listed in the order they were added");
+    free_key_list(&keys);
+    jxsl_close(doc);
+    check(value_is(filename, "k0x", "again") && value_is(filename, "k1x", "and again"), "file-based reads of an emptied document");
+    jxsl_close(NULL);
+}
+
+// top-level keys "key<i>" with nested members that are not listed, and last a key longer than any line buffer
+static void write_many_keys(const char* filename, bool json, int count, const char* long_key) {
+    FILE* file = fopen(filename, "w");
+    if (json) {
+        fprintf(file, "{\n");
+        for (int i = 0; i < count; i++) fprintf(file, "    \"key%d\": \"v%d\",\n", i, i);
+        fprintf(file, "    \"%s\": {\"nested\": [1, {\"x\": \"}\"}]}\n}\n", long_key);
+    } else {
+        fprintf(file, "<?xml version=\"1.0\"?>\n<root>\n");
+        for (int i = 0; i < count; i++) fprintf(file, "    <key%d>v%d</key%d>\n", i, i, i);
+        fprintf(file, "    <%s a=\"1\"><nested>x</nested></%s>\n</root>\n", long_key, long_key);
+    }
+    fclose(file);
+}
+
+static void test_key_listing(const char* filename, bool json) {
+    enum { COUNT = 3000 };
+    char* long_key = malloc(5001);
+    memset(long_key, 'q', 5000);
+    long_key[5000] = '\0';
+    write_many_keys(filename, json, COUNT, long_key);
+
+    key_list list;
+    check(list_keys(filename, &list) && list.count == COUNT + 1, "list_keys lists every key, however many");
+    bool in_order = list.count == COUNT + 1;
+    char expected[32];
+    for (int i = 0; in_order && i < COUNT; i++) {
+        snprintf(expected, sizeof(expected), "key%d", i);
+        in_order = strcmp(list.text + list.offsets[i], expected) == 0;
+    }
+    check(in_order && strcmp(list.text + list.offsets[COUNT], long_key) == 0, "keys listed in file order, long ones whole");
+    free_key_list(&list);
+    check(list.text == NULL && list.count == 0, "free_key_list empties the list");
+
+    // too small an array: nothing is copied and the number needed comes back
+    char* keys[COUNT + 2];
+    for (int i = 0; i < COUNT + 2; i++) keys[i] = NULL;
+    int num_keys = 10;
+    check(!find_keys(filename, keys, &num_keys) && num_keys == COUNT + 1, "find_keys reports how many keys there are");
+    bool untouched = true;
+    for (int i = 0; i < COUNT + 2; i++) untouched = untouched && keys[i] == NULL;
+    check(untouched, "find_keys copies nothing when the array is too small");
+
+    // exactly large enough, and larger
+    num_keys = COUNT + 1;
+    check(find_keys(filename, keys, &num_keys) && num_keys == COUNT + 1 && strcmp(keys[COUNT], long_key) == 0,
+          "find_keys fills an array of exactly the right size");
+    for (int i = 0; i < num_keys; i++) free(keys[i]);
+    num_keys = COUNT + 2;
+    check(find_keys(filename, keys, &num_keys) && num_keys == COUNT + 1 && strcmp(keys[0], "key0") == 0,
+          "find_keys sets the count when the array is larger");
+    for (int i = 0; i < num_keys; i++) free(keys[i]);
+
+    // the handle reports the same way
+    jxsl_doc* doc = jxsl_open(filename, 0);
+    num_keys = COUNT;
+    check(doc != NULL && !jxsl_find_keys(doc, keys, &num_keys) && num_keys == COUNT + 1, "jxsl_find_keys reports overflow");
+    check(jxsl_delete(doc, "key3") && jxsl_list_keys(doc, &list) && list.count == COUNT &&
+              strcmp(list.text + list.offsets[3], "key4") == 0, "jxsl_list_keys leaves deleted keys out");
+    free_key_list(&list);
+    num_keys = COUNT;
+    check(jxsl_find_keys(doc, keys, &num_keys) && num_keys == COUNT, "jxsl_find_keys after a delete");
+    for (int i = 0; i < num_keys; i++) free(keys[i]);
+    jxsl_close(doc);
+    free(long_key);
+}
+
+static void test_key_listing_edge_cases(void) {
+    write_text("c_test_empty.json", "");
+    key_list list;
+    check(list_keys("c_test_empty.json", &list) && list.count == 0, "an empty file has no keys");
+    free_key_list(&list);
+    check(!list_keys("c_test_missing.json", &list) && list.count == 0, "a missing file lists nothing");
+    char* keys[1];
+    int num_keys = 0;
+    write_text("c_test_one.json", "{\"only\": 1}");
+    check(!find_keys("c_test_one.json", keys, &num_keys) && num_keys == 1, "find_keys with no room at all");
+}
+
+// the file without whitespace outside of JSON strings and without the XML declaration
+static void read_canonical(const char* filename, char* text, size_t text_size) {
+    FILE* file = fopen(filename, "r");
+    size_t length = 0;
+    bool in_string = false;
+    int c;
+    while (file && (c = fgetc(file)) != EOF && length + 1 < text_size) {
+        if (c == '"' && (length == 0 || text[length - 1] != '\\')) in_string = !in_string;
+        if (in_string || (c != ' ' && c != '\t' && c != '\r' && c != '\n')) text[length++] = (char)c;
+    }
+    text[length] = '\0';
+    if (file) fclose(file);
+    if (strncmp(text, "<?", 2) == 0 && strstr(text, "?>")) memmove(text, strstr(text, "?>") + 2, strlen(strstr(text, "?>") + 2) + 1);
+}
+
+// values with commas, braces and quotes inside strings, and nested containers
+static const char* const batch_values[] = {"\"v\"", "12", "{\"x\": [1, 2]}", "\"a, b\"", "\"}\"", "[]"};
+static const char* const batch_canonical[] = {"\"v\"", "12", "{\"x\":[1,2]}", "\"a, b\"", "\"}\"", "[]"};
+
+// members k0..k<count-1> laid out in one of several styles
+static void write_batch_json(const char* filename, int count, int style) {
+    static const char* const separators[] = {", ", ",\n    ", " ,\n    ", "\t,\r\n\t", ","};
+    FILE* file = fopen(filename, "w");
+    fprintf(file, style == 4 ? "{" : "{\n    ");
+    for (int i = 0; i < count; i++) {
+        fprintf(file, "%s\"k%dx\": %s", i ? separators[style] : "", i, batch_values[i % 6]);
+    }
+    fprintf(file, style == 4 ? "}" : "\n}\n");
+    fclose(file);
+}
+
+static void test_batch_delete_commas(void) {
+    const char* filename = "c_test_batch.json";
+    char text[1024], expected[1024], names[6][8];
+    bool all_valid = true, all_counted = true;
+    for (int style = 0; style < 5; style++) {
+        for (int count = 1; count <= 6; count++) {
+            for (int subset = 0; subset < (1 << count); subset++) {
+                write_batch_json(filename, count, style);
+                const char* keys[8];
+                int num_keys = 0, wanted = 0;
+                strcpy(expected, "{");
+                for (int i = 0; i < count; i++) {
+                    snprintf(names[i], sizeof(names[i]), "k%dx", i);
+                    if (subset & (1 << i)) {
+                        keys[num_keys++] = names[i];
+                        wanted++;
+                    } else {
+                        snprintf(expected + strlen(expected), sizeof(expected) - strlen(expected), "%s\"%s\":%s",
+                                 strlen(expected) > 1 ? "," : "", names[i], batch_canonical[i % 6]);
+                    }
+                }
+                strcat(expected, "}");
+                if (num_keys > 0) keys[num_keys++] = keys[0]; // listed twice
+                keys[num_keys++] = "absent";
+
+                int deleted = -1;
+                bool any = delete_data_batch(filename, keys, num_keys, &deleted);
+                all_counted = all_counted && deleted == wanted && any == (wanted > 0);
+                read_canonical(filename, text, sizeof(text));
+                if (strcmp(text, expected) != 0) {
+                    if (all_valid) fprintf(stderr, "style %d, subset %d of %d: %s, expected %s\n", style, subset, count, text, expected);
+                    all_valid = false;
+                }
+            }
+        }
+    }
+    check(all_valid, "batch deletes leave exactly the other members and their commas");
+    check(all_counted, "batch deletes count each key once");
+
+    // emptied by a batch, then filled through the other functions
+    write_batch_json(filename, 3, 1);
+    const char* all[] = {"k0x", "k1x", "k2x"};
+    check(delete_data_batch(filename, all, 3, NULL), "delete every member at once");
+    read_canonical(filename, text, sizeof(text));
+    check(strcmp(text, "{}") == 0, "an emptied object stays an object");
+    check(add_data_json(filename, "k5x", "five") && add_data_json(filename, "k6x", "six"), "add after a batch delete");
+    read_canonical(filename, text, sizeof(text));
+    check(strcmp(text, "{\"k5x\":\"five\",\"k6x\":\"six\"}") == 0, "members added after a batch delete");
+
+    // XML: whole lines go, and the index follows
+    const char* xml = "c_test_batch.xml";
+    unlink("c_test_batch.xml.idx");
+    create_file(xml, "XML");
+    char key[16], value[16];
+    for (int i = 0; i < 20; i++) {
+        snprintf(key, sizeof(key), "k%dx", i);
+        snprintf(value, sizeof(value), "value%d", i);
+        add_data_xml(xml, key, value);
+    }
+    const char* some[] = {"k0x", "k7x", "k8x", "k19x", "absent"};
+    int deleted = 0;
+    check(delete_data_batch(xml, some, 5, &deleted) && deleted == 4, "XML batch delete");
+    bool indexed = true;
+    for (int i = 0; i < 20; i++) {
+        snprintf(key, sizeof(key), "k%dx", i);
+        snprintf(value, sizeof(value), "value%d", i);
+        bool gone = i == 0 || i == 7 || i == 8 || i == 19;
+        indexed = indexed && value_is(xml, key, value) == !gone;
+    }
+    check(indexed, "XML values read through the index after a batch delete");
+    read_canonical(xml, text, sizeof(text));
+    check(strncmp(text, "<root><k1x>value1</k1x>", 23) == 0 && strstr(text, "<k18x>value18</k18x></root>") != NULL &&
+              strstr(text, "k7x") == NULL, "XML batch delete leaves the other elements");
+    check(!delete_data_batch("c_test_batch.txt", some, 5, &deleted) && deleted == 0, "unsupported file type");
+}
+
+int main(void) {
+    test_xml_index_follows_edits();
+    test_xml_index_rebuilt_when_stale();
+    test_handle_operations("c_test_handle.json");
+    test_handle_operations("c_test_handle.xml");
+    test_key_listing("c_test_keys.json", true);
+    test_key_listing("c_test_keys.xml", false);
+    test_key_listing_edge_cases();
+    test_batch_delete_commas();
+
+    if (failures) {
+        fprintf(stderr, "%d check(s) failed\n", failures);
+        return 1;
+    }
+    printf("All C library tests passed\n");
+    return 0;
+}
@@ -0,0 +1,213 @@
+// Compressed container tests: documents of several blocks written and read back through JXSL, lazy lookups that
+// decompress single blocks, changes flushed into a container, and damaged containers that must be rejected
+
+#include "jxsl_compressed_file.h"
+#include "jxsl_lib_cpp.h"
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+
+using Contents = std::map<std::string, std::string>;
+
+int failures = 0;
+
+void check(const bool condition, const std::string& what) {
+    if (!condition) {
+        std::cerr << "[FAIL] " << what << "\n";
+        failures++;
+    }
+}
+
+std::string readText(const std::string& filename) {
+    std::ifstream file(filename, std::ios::binary);
+    std::ostringstream text;
+    text << file.rdbuf();
+    return text.str();
+}
+
+void writeText(const std::string& filename, const std::string& text) {
+    std::ofstream file(filename, std::ios::binary | std::ios::trunc);
+    file << text;
+}
+
+JxslOptions withMode(const LoadMode mode) {
+    JxslOptions options;
+    options.loadMode = mode;
+    return options;
+}
+
+// every member as the handler reads it
+Contents contentsOf(JXSL& handler) {
+    Contents contents;
+    std::vector<std::string> keys;
+    handler.findKeys(keys);
+    for (const std::string& key : keys) handler.readData(key, contents[key]);
+    return contents;
+}
+
+// a plain file of members that add up to several blocks; the values repeat enough to compress
+Contents writePlain(const std::string& filename, const bool json) {
+    Contents contents;
+    std::string text = json ? "{" : "<root>";
+    for (int i = 0; i < 5000; i++) {
+        const std::string key = "member" + std::to_string(i);
+        const std::string value = "value " + std::to_string(i) + " of a document that is written compressed";
+        contents[key] = value;
+        text += json ? (i ? ",\n    \"" : "\n    \"") + key + "\": \"" + value + "\""
+                     : "\n    <" + key + ">" + value + "</" + key + ">";
+    }
+    text += json ? "\n}" : "\n</root>";
+    writeText(filename, text);
+    return contents;
+}
+
+// the raw bytes of the container: header (24 bytes), then one 24-byte index entry per block with the offset of the
+// block's filter (8 bytes), the packed and raw sizes and the filter size; the packed bytes follow the filter
+struct Layout {
+    uint64_t filterAt;
+    uint32_t packedSize;
+    uint32_t filterBytes;
+};
+
+uint32_t getU32(const std::string& text, const size_t at) {
+    uint32_t value = 0;
+    for (int i = 0; i < 4; i++) value |= static_cast<uint32_t>(static_cast<uint8_t>(text[at + i])) << (8 * i);
+    return value;
+}
+
+Layout blockLayout(const std::string& text, const size_t block) {
+    const size_t entry = 24 + block * 24;
+    return {getU32(text, entry) | static_cast<uint64_t>(getU32(text, entry + 4)) << 32, getU32(text, entry + 8),
+            getU32(text, entry + 16)};
+}
+
+// written compressed, the document comes back the same, whole or block by block
+void testRoundTrip(const std::string& filename, const bool json) {
+    Contents expected = writePlain(filename, json);
+    {
+        JxslOptions options;
+        options.compress = true;
+        JXSL handler(filename, options);
+        check(handler.addData("added", "written with the first flush"), filename + ": add");
+        expected["added"] = "written with the first flush";
+    }
+    const std::string packed = readText(filename);
+    check(CompressedFile::detect(packed), filename + ": not written as a container");
+    CompressedFile container;
+    check(container.open(packed) && container.blockCount() >= 4, filename + ": fewer blocks than expected");
+    check(packed.size() < container.rawSize() / 2, filename + ": the container is not smaller than the text");
+
+    for (const LoadMode mode : {LoadMode::Eager, LoadMode::Lazy}) {
+        JXSL handler(filename, withMode(mode));
+        check(contentsOf(handler) == expected, filename + ": contents differ after a reload");
+    }
+}
+
+// a lazy read of a key decompresses only the blocks whose filters may hold it: keys in later blocks, in any order,
+// and keys that are not there at all
+void testLazyLookups(const std::string& filename) {
+    JXSL handler(filename, withMode(LoadMode::Lazy));
+    std::string value;
+    for (const int i : {4999, 4000, 2500, 10, 3999}) {
+        const std::string key = "member" + std::to_string(i);
+        check(handler.readData(key, value) && value == "value " + std::to_string(i) + " of a document that is written compressed",
+              filename + ": lazy read of " + key);
+    }
+    check(!handler.readData("member5000", value) && !handler.readData("missing", value),
+          filename + ": lazy read of a key that is not there");
+}
+
+// changes to a container are flushed into a new container and survive a reload in either mode
+void testChangesReloaded(const std::string& filename) {
+    Contents expected;
+    {
+        JXSL handler(filename, withMode(LoadMode::Eager));
+        expected = contentsOf(handler);
+    }
+    {
+        JXSL handler(filename, withMode(LoadMode::Lazy));
+        check(handler.editData("member4500", "edited in a late block"), filename + ": edit");
+        check(handler.editData("member1", "edited in the first block, and longer than the value it replaces"),
+              filename + ": edit");
+        check(handler.deleteData("member3000") && handler.deleteData("member0"), filename + ": delete");
+        check(handler.addData("late", "added"), filename + ": add");
+        handler.flushToFile();
+        check(handler.flushStats().rewrites == 1, filename + ": flush did not write a new container");
+    }
+    expected["member4500"] = "edited in a late block";
+    expected["member1"] = "edited in the first block, and longer than the value it replaces";
+    expected.erase("member3000");
+    expected.erase("member0");
+    expected["late"] = "added";
+
+    check(CompressedFile::detect(readText(filename)), filename + ": no longer a container after a flush");
+    for (const LoadMode mode : {LoadMode::Eager, LoadMode::Lazy}) {
+        JXSL handler(filename, withMode(mode));
+        check(contentsOf(handler) == expected, filename + ": changes lost after a reload");
+    }
+}
+
+// a damaged container is refused as a whole rather than read with keys or text missing
+void testCorruption(const std::string& filename) {
+    const std::string intact = readText(filename);
+    const Layout second = blockLayout(intact, 1);
+    const Layout last = blockLayout(intact, 3);
+
+    struct Damage {
+        const char* what;
+        size_t at;
+        char value;
+    };
+    const Damage damages[] = {
+        {"filter", second.filterAt + second.filterBytes / 2, '\x5a'},
+        {"packed data", last.filterAt + last.filterBytes + last.packedSize / 2, '\x5a'},
+        {"filter size", 24 + 1 * 24 + 16, '\x07'},
+        {"block count", 12, '\x7f'},
+    };
+    for (const Damage& damage : damages) {
+        std::string damaged = intact;
+        damaged[damage.at] = damaged[damage.at] == damage.value ? static_cast<char>(~damage.value) : damage.value;
+        CompressedFile container;
+        check(!container.open(damaged), filename + ": container with a damaged " + damage.what + " opened");
+
+        writeText(filename, damaged);
+        for (const LoadMode mode : {LoadMode::Eager, LoadMode::Lazy}) {
+            JXSL handler(filename, withMode(mode));
+            std::string value;
+            check(!handler.readData("member4999", value) && !handler.readData("member2", value),
+                  filename + ": read from a container with a damaged " + damage.what);
+        }
+        check(readText(filename) == damaged, filename + ": damaged container was changed");
+    }
+    writeText(filename, intact);
+}
+
+void testContainer(const std::string& filename, const bool json) {
+    std::remove(filename.c_str());
+    testRoundTrip(filename, json);
+    testLazyLookups(filename);
+    testChangesReloaded(filename);
+    testCorruption(filename);
+    std::remove(filename.c_str());
+}
+
+} // namespace
+
+int main() {
+    testContainer("compressed_test.json", true);
+    testContainer("compressed_test.xml", false);
+
+    if (failures) {
+        std::cerr << failures << " check(s) failed\n";
+        return 1;
+    }
+    std::cout << "All compressed container tests passed\n";
+    return 0;
+}
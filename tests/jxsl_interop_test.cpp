@@ -0,0 +1,327 @@
+// Interoperability tests: the C and C++ implementations take turns changing the same file, which has to stay
+// well-formed and hold exactly what both of them wrote
+
+#include "jxsl_lib_cpp.h"
+#include "jxsl_document.h"
+extern "C" {
+#include "JXSL_C/jxsl_lib.h"
+}
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+
+using Contents = std::map<std::string, std::string>;
+
+int failures = 0;
+
+void check(const bool condition, const std::string& what) {
+    if (!condition) {
+        std::cerr << "[FAIL] " << what << "\n";
+        failures++;
+    }
+}
+
+std::string readText(const std::string& filename) {
+    std::ifstream file(filename, std::ios::binary);
+    std::ostringstream text;
+    text << file.rdbuf();
+    return text.str();
+}
+
+// the root closes exactly once, at the end of the text: the parser alone stops at the root and ignores what follows
+bool closesAtEnd(const std::string& text, const bool json) {
+    const size_t last = text.find_last_not_of(" \t\r\n");
+    if (last == std::string::npos || text.find('\0') != std::string::npos) return false;
+    if (!json) {
+        const std::string close = "</root>";
+        return last + 1 >= close.size() && text.compare(last + 1 - close.size(), close.size(), close) == 0 &&
+               text.find(close) == last + 1 - close.size();
+    }
+    int depth = 0;
+    bool quoted = false;
+    for (size_t i = 0; i <= last; i++) {
+        if (quoted) {
+            if (text[i] == '\\') i++;
+            else if (text[i] == '"') quoted = false;
+        } else if (text[i] == '"') {
+            quoted = true;
+        } else if (text[i] == '{' || text[i] == '[') {
+            depth++;
+        } else if ((text[i] == '}' || text[i] == ']') && --depth == 0) {
+            return i == last;
+        }
+    }
+    return false;
+}
+
+// members of the root as parsed from the file; false if the file is not well-formed
+bool parseFile(const std::string& filename, Contents& contents) {
+    const bool json = filename.ends_with(".json");
+    const std::string text = readText(filename);
+    Document document;
+    if (!closesAtEnd(text, json) || !(json ? document.parseJson(text) : document.parseXml(text))) return false;
+    contents.clear();
+    for (const DocumentNode* node = document.root()->firstChild; node; node = node->next) {
+        contents[std::string(node->key)] = std::string(node->text);
+    }
+    return true;
+}
+
+size_t lineCount(const std::string& filename) {
+    const std::string text = readText(filename);
+    return std::count(text.begin(), text.end(), '\n');
+}
+
+bool addC(const std::string& filename, const std::string& key, const std::string& value) {
+    return filename.ends_with(".json") ? add_data_json(filename.c_str(), key.c_str(), value.c_str())
+                                       : add_data_xml(filename.c_str(), key.c_str(), value.c_str());
+}
+
+// the file is well-formed, holds what is expected, and both implementations read it that way
+void verify(const std::string& filename, const Contents& expected, const std::string& step) {
+    Contents found;
+    if (!parseFile(filename, found)) {
+        check(false, filename + ": not well-formed after " + step + ":\n" + readText(filename));
+        return;
+    }
+    check(found == expected, filename + ": unexpected contents after " + step + ":\n" + readText(filename));
+
+    JXSL handler(filename);
+    std::vector<std::string> keys;
+    handler.findKeys(keys);
+    check(keys.size() == expected.size(), filename + ": C++ key count after " + step);
+    for (const auto& [key, value] : expected) {
+        std::string cppValue;
+        char cValue[1024] = {};
+        check(handler.readData(key, cppValue) && cppValue == value, filename + ": C++ read of " + key + " after " + step);
+        check(read_data(filename.c_str(), key.c_str(), cValue) && value == cValue,
+              filename + ": C read of " + key + " after " + step);
+    }
+}
+
+void testTurns(const std::string& filename, const std::string& format) {
+    std::remove(filename.c_str());
+    check(create_file(filename.c_str(), format.c_str()), filename + ": create");
+    Contents expected;
+
+    {
+        JXSL handler(filename); // every handler below writes its changes when it is destroyed
+        check(handler.addData("alpha", "one"), filename + ": C++ add");
+    }
+    expected["alpha"] = "one";
+    verify(filename, expected, "C++ add");
+
+    check(addC(filename, "beta", "two"), filename + ": C add");
+    expected["beta"] = "two";
+    verify(filename, expected, "C add");
+
+    {
+        JXSL handler(filename);
+        check(handler.editData("alpha", "one-and-a-half"), filename + ": C++ edit");
+    }
+    expected["alpha"] = "one-and-a-half";
+    verify(filename, expected, "C++ edit to a longer value");
+
+    check(edit_data(filename.c_str(), "alpha", "1"), filename + ": C edit");
+    expected["alpha"] = "1";
+    verify(filename, expected, "C edit to a shorter value");
+
+    const size_t lines = lineCount(filename);
+    {
+        JXSL handler(filename);
+        check(handler.editData("beta", "2"), filename + ": C++ edit in place");
+        check(handler.editData("alpha", "0"), filename + ": C++ edit in place");
+    }
+    expected["beta"] = "2";
+    expected["alpha"] = "0";
+    verify(filename, expected, "C++ edit in place");
+    check(lineCount(filename) == lines, filename + ": the padding of an edit in place took a line break:\n" + readText(filename));
+
+    check(delete_data(filename.c_str(), "alpha"), filename + ": C delete");
+    expected.erase("alpha");
+    verify(filename, expected, "C delete");
+
+    {
+        JXSL handler(filename);
+        check(handler.deleteData("beta"), filename + ": C++ delete");
+        check(handler.addData("gamma", "three"), filename + ": C++ add after delete");
+    }
+    expected.erase("beta");
+    expected["gamma"] = "three";
+    verify(filename, expected, "C++ delete and add");
+}
+
+// the C library changes the file while a C++ handler has it loaded: the handler's offsets no longer fit the file, so
+// its changes must not be patched in at them. The flush rewrites the file from what the handler holds, the file as it
+// was loaded plus the handler's own changes: the last writer wins, and what C wrote in between is gone
+void testChangedUnderneath(const std::string& filename, const std::string& format) {
+    std::remove(filename.c_str());
+    check(create_file(filename.c_str(), format.c_str()), filename + ": create");
+    check(addC(filename, "alpha", "one") && addC(filename, "beta", "two"), filename + ": C add");
+
+    {
+        JXSL handler(filename);
+        check(addC(filename, "gamma", "three"), filename + ": C add while loaded");
+        check(handler.editData("alpha", "1"), filename + ": C++ edit after the file changed");
+    }
+    verify(filename, {{"alpha", "1"}, {"beta", "two"}}, "a C++ edit of a file C added to");
+
+    {
+        JXSL handler(filename);
+        check(edit_data(filename.c_str(), "beta", "a value longer than the old one"), filename + ": C edit while loaded");
+        check(handler.addData("delta", "four"), filename + ": C++ add after the file changed");
+    }
+    verify(filename, {{"alpha", "1"}, {"beta", "two"}, {"delta", "four"}}, "a C++ add to a file C edited");
+
+    // C grows the first member, which moves every member behind it; C++ changes one of those and leaves the other
+    check(addC(filename, "gamma", "three"), filename + ": C add");
+    {
+        JXSL handler(filename);
+        check(edit_data(filename.c_str(), "alpha", "a value longer than the old one"), filename + ": C edit while loaded");
+        check(handler.editData("gamma", "3"), filename + ": C++ edit behind the C edit");
+    }
+    verify(filename, {{"alpha", "1"}, {"beta", "two"}, {"delta", "four"}, {"gamma", "3"}},
+           "a C++ edit behind a member C grew");
+}
+
+// a loaded file edited by the C library, which grows a member in place and moves the ones behind it: by default the
+// C++ entries are copies, so they keep the values as loaded instead of showing the shifted bytes
+void testEditedInPlaceWhileLoaded(const std::string& filename, const std::string& format, const LoadMode mode) {
+    const std::string name = filename + (mode == LoadMode::Lazy ? " (lazy)" : " (eager)");
+    std::remove(filename.c_str());
+    check(create_file(filename.c_str(), format.c_str()), name + ": create");
+    check(addC(filename, "alpha", "one") && addC(filename, "beta", "two") && addC(filename, "gamma", "three"),
+          name + ": C add");
+
+    {
+        JxslOptions options;
+        options.loadMode = mode;
+        JXSL handler(filename, options);
+        check(edit_data(filename.c_str(), "alpha", "a value longer than the old one"), name + ": C edit while loaded");
+        std::string value;
+        check(handler.readData("gamma", value) && value == "three", name + ": C++ read of a member behind the C edit");
+        check(handler.readData("beta", value) && value == "two", name + ": C++ read of the next member");
+        check(handler.readData("alpha", value) && value == "one", name + ": C++ read of the member C edited");
+    } // nothing changed through the handler: the file stays as C left it
+    verify(filename, {{"alpha", "a value longer than the old one"}, {"beta", "two"}, {"gamma", "three"}},
+           "a C edit of a file loaded by C++");
+    std::remove(filename.c_str());
+}
+
+// with zeroCopy the entries view the mapped file, and C writes a value that fits in place, so after a change by C
+// they cannot be trusted: the flush refuses to write them instead of putting what they show now into the file
+void testZeroCopyRefusesChangedFile(const std::string& filename, const std::string& format) {
+    std::remove(filename.c_str());
+    check(create_file(filename.c_str(), format.c_str()), filename + ": create");
+    check(addC(filename, "alpha", "one") && addC(filename, "beta", "two") && addC(filename, "gamma", "three"),
+          filename + ": C add");
+    const Contents written = {{"alpha", "1"}, {"beta", "two"}, {"gamma", "three"}};
+
+    {
+        JxslOptions options;
+        options.zeroCopy = true;
+        options.flushPolicy.flushOnDestruction = false;
+        JXSL handler(filename, options);
+        check(edit_data(filename.c_str(), "alpha", written.at("alpha").c_str()), filename + ": C edit while mapped");
+        check(handler.editData("gamma", "3"), filename + ": C++ edit after the file changed");
+        handler.flushToFile();
+        check(handler.flushStats().failedFlushes == 1 && handler.flushStats().flushes == 0,
+              filename + ": flush of mapped entries after the file changed not refused");
+    }
+    verify(filename, written, "a refused flush of a changed file");
+    std::remove(filename.c_str());
+}
+
+// C changes that move members write a new version of the file and rename it over the old one: a C++ handler that
+// has the old file mapped (zeroCopy) keeps reading the members as they were loaded
+void testGrowingEditsKeepMappedFile(const std::string& filename, const std::string& format, const LoadMode mode) {
+    const std::string name = filename + (mode == LoadMode::Lazy ? " (lazy)" : " (eager)");
+    std::remove(filename.c_str());
+    check(create_file(filename.c_str(), format.c_str()), name + ": create");
+    check(addC(filename, "alpha", "one") && addC(filename, "beta", "two") && addC(filename, "gamma", "three"),
+          name + ": C add");
+    const std::string longer = "a value longer than the old one";
+
+    {
+        JxslOptions options;
+        options.loadMode = mode;
+        options.zeroCopy = true;
+        JXSL handler(filename, options);
+        check(edit_data(filename.c_str(), "alpha", longer.c_str()), name + ": C edit while mapped");
+        jxsl_doc* doc = jxsl_open(filename.c_str(), 0);
+        check(doc && jxsl_edit(doc, "beta", longer.c_str()) && jxsl_add(doc, "delta", "four"),
+              name + ": C handle changes while mapped");
+        jxsl_close(doc);
+        std::string value;
+        check(handler.readData("gamma", value) && value == "three", name + ": C++ read of a member behind the C edits");
+        check(handler.readData("beta", value) && value == "two", name + ": C++ read of a member C grew");
+        check(handler.readData("alpha", value) && value == "one", name + ": C++ read of the first member");
+        check(!handler.readData("delta", value), name + ": C++ read of a member C added after the load");
+    }
+    verify(filename, {{"alpha", longer}, {"beta", longer}, {"gamma", "three"}, {"delta", "four"}},
+           "C changes that move members of a mapped file");
+    std::remove(filename.c_str());
+}
+
+// C deletes, which move every member behind the deleted ones, replace the file the same way: a C++ handler that has
+// the old file mapped still reads the members C deleted and the ones that moved
+void testDeletesKeepMappedFile(const std::string& filename, const std::string& format, const LoadMode mode) {
+    const std::string name = filename + (mode == LoadMode::Lazy ? " (lazy)" : " (eager)");
+    std::remove(filename.c_str());
+    check(create_file(filename.c_str(), format.c_str()), name + ": create");
+    const std::vector<std::string> keys = {"alpha", "beta", "gamma", "delta", "epsilon", "zeta"};
+    for (const std::string& key : keys) check(addC(filename, key, key + " value"), name + ": C add of " + key);
+
+    {
+        JxslOptions options;
+        options.loadMode = mode;
+        options.zeroCopy = true;
+        JXSL handler(filename, options);
+        check(delete_data(filename.c_str(), "alpha"), name + ": C delete while mapped");
+        const char* batch[] = {"gamma", "epsilon"};
+        int deleted = 0;
+        check(delete_data_batch(filename.c_str(), batch, 2, &deleted) && deleted == 2, name + ": C batch delete while mapped");
+        jxsl_doc* doc = jxsl_open(filename.c_str(), 0);
+        check(doc && jxsl_delete(doc, "beta"), name + ": C handle delete while mapped");
+        jxsl_close(doc);
+        for (const std::string& key : keys) {
+            std::string value;
+            check(handler.readData(key, value) && value == key + " value", name + ": C++ read of " + key + " after C deletes");
+        }
+    }
+    verify(filename, {{"delta", "delta value"}, {"zeta", "zeta value"}}, "C deletes from a mapped file");
+    std::remove(filename.c_str());
+}
+
+} // namespace
+
+int main() {
+    testTurns("interop_test.json", "JSON");
+    testTurns("interop_test.xml", "XML");
+    testChangedUnderneath("interop_changed.json", "JSON");
+    testChangedUnderneath("interop_changed.xml", "XML");
+    testZeroCopyRefusesChangedFile("interop_zero_copy.json", "JSON");
+    testZeroCopyRefusesChangedFile("interop_zero_copy.xml", "XML");
+    for (const LoadMode mode : {LoadMode::Eager, LoadMode::Lazy}) {
+        testEditedInPlaceWhileLoaded("interop_in_place.json", "JSON", mode);
+        testEditedInPlaceWhileLoaded("interop_in_place.xml", "XML", mode);
+        testGrowingEditsKeepMappedFile("interop_renamed.json", "JSON", mode);
+        testGrowingEditsKeepMappedFile("interop_renamed.xml", "XML", mode);
+        testDeletesKeepMappedFile("interop_deleted.json", "JSON", mode);
+        testDeletesKeepMappedFile("interop_deleted.xml", "XML", mode);
+    }
+
+    if (failures) {
+        std::cerr << failures << " check(s) failed\n";
+        return 1;
+    }
+    std::cout << "All interoperability tests passed\n";
+    return 0;
+}
@@ -131,10 +131,12 @@ void runTestsFile(const std::string& testFilename) {
         return;
     }
 
+    JxslOptions options;
+    options.loadMode = LoadMode::Lazy; // one operation per handler: parse only what it touches
     std::string operation, fileType, key, value;
     while (testFile >> operation >> fileType >> key >> value) {
         std::string handlerFilename = (fileType == "json") ? "test.json" : "test.xml";
-        JXSL handler(handlerFilename);
+        JXSL handler(handlerFilename, options);
 
         std::ostringstream logMessageStream;
         if (operation == "add") {
@@ -0,0 +1,362 @@
+// Option tests: each JxslOptions setting is exercised through a JXSL handler on a real file
+
+#include "jxsl_lib_cpp.h"
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <memory_resource>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define JXSL_POSIX_IO 1
+#include <csignal>
+#include <fcntl.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+int failures = 0;
+
+void check(const bool condition, const std::string& what) {
+    if (!condition) {
+        std::cerr << "[FAIL] " << what << "\n";
+        failures++;
+    }
+}
+
+std::string readText(const std::string& filename) {
+    std::ifstream file(filename, std::ios::binary);
+    std::ostringstream text;
+    text << file.rdbuf();
+    return text.str();
+}
+
+void writeText(const std::string& filename, const std::string& text) {
+    std::ofstream file(filename, std::ios::binary | std::ios::trunc);
+    file << text;
+}
+
+// the value of the key as a fresh handler reads it from the file; empty if it is not there
+std::string valueInFile(const std::string& filename, const std::string& key) {
+    JXSL reader(filename);
+    std::string value;
+    return reader.readData(key, value) ? value : "";
+}
+
+// a policy with every limit off
+FlushPolicy noLimits() {
+    FlushPolicy policy;
+    policy.maxPendingChanges = 0;
+    policy.maxDirtyBytes = 0;
+    policy.maxAge = std::chrono::milliseconds(0);
+    return policy;
+}
+
+// waits until flushes have written that many changes (or gives up after a few seconds)
+bool waitForFlushed(const JXSL& handler, const uint64_t changes) {
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (handler.flushStats().changesFlushed < changes) {
+        if (std::chrono::steady_clock::now() > deadline) return false;
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    return true;
+}
+
+// counts what goes through it; everything is passed on to the upstream resource
+class CountingResource : public std::pmr::memory_resource {
+public:
+    explicit CountingResource(std::pmr::memory_resource* upstream) : upstream(upstream) {}
+    size_t allocations = 0;
+    size_t outstanding = 0; // bytes allocated and not deallocated yet
+
+private:
+    std::pmr::memory_resource* upstream;
+
+    void* do_allocate(const size_t bytes, const size_t alignment) override {
+        allocations++;
+        outstanding += bytes;
+        return upstream->allocate(bytes, alignment);
+    }
+    void do_deallocate(void* p, const size_t bytes, const size_t alignment) override {
+        outstanding -= bytes;
+        upstream->deallocate(p, bytes, alignment);
+    }
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override { return this == &other; }
+};
+
+// every allocation of the handler comes from memoryResource, none from the default resource, and all of it is
+// given back when the handler goes
+void testMemoryResource(const std::string& filename, const LoadMode mode, const std::string& name) {
+    const bool json = filename.ends_with(".json");
+    std::string text = json ? "{" : "<root>";
+    for (int i = 0; i < 200; i++) {
+        const std::string key = "key" + std::to_string(i);
+        const std::string value = "a value long enough to need its own allocation " + std::to_string(i);
+        text += json ? (i ? ", \"" : "\"") + key + "\": \"" + value + "\"" : "<" + key + ">" + value + "</" + key + ">";
+    }
+    text += json ? "}" : "</root>";
+    writeText(filename, text);
+
+    CountingResource counted(std::pmr::new_delete_resource());
+    CountingResource fallback(std::pmr::new_delete_resource());
+    std::pmr::memory_resource* previous = std::pmr::set_default_resource(&fallback);
+    {
+        JxslOptions options;
+        options.loadMode = mode;
+        options.memoryResource = &counted;
+        JXSL handler(filename, options);
+        std::string value;
+        check(handler.readData("key150", value) && value == "a value long enough to need its own allocation 150",
+              name + ": read");
+        check(handler.editData("key3", "an edited value that is longer than any of the values loaded"), name + ": edit");
+        check(handler.addData("added", "a new value long enough to need its own allocation"), name + ": add");
+        check(handler.deleteData("key0"), name + ": delete");
+        handler.flushToFile();
+        std::vector<char> buffer(handler.serializedSize());
+        check(handler.serializeTo(buffer) == buffer.size(), name + ": serialize");
+        check(counted.allocations > 0, name + ": nothing allocated from memoryResource");
+    }
+    std::pmr::set_default_resource(previous);
+    check(fallback.allocations == 0,
+          name + ": " + std::to_string(fallback.allocations) + " allocation(s) from the default resource");
+    check(counted.outstanding == 0, name + ": " + std::to_string(counted.outstanding) + " byte(s) not given back");
+
+    // a monotonic resource per handler, released in one go at the end
+    {
+        std::pmr::monotonic_buffer_resource arena(std::pmr::new_delete_resource());
+        JxslOptions options;
+        options.loadMode = mode;
+        options.memoryResource = &arena;
+        JXSL handler(filename, options);
+        std::string value;
+        check(handler.readData("key3", value) && value == "an edited value that is longer than any of the values loaded",
+              name + ": edit lost");
+        check(handler.readData("added", value) && value == "a new value long enough to need its own allocation",
+              name + ": add lost");
+        check(!handler.readData("key0", value), name + ": deleted member is back");
+        check(handler.readData("key199", value) && value == "a value long enough to need its own allocation 199",
+              name + ": read from a monotonic resource");
+    }
+    std::remove(filename.c_str());
+}
+
+// each limit of the policy starts a flush from the change that reaches it, and only then
+void testFlushPolicy(const std::string& filename) {
+    writeText(filename, "{}");
+    JxslOptions options;
+    options.flushPolicy = noLimits();
+    options.flushPolicy.maxPendingChanges = 3;
+    {
+        JXSL handler(filename, options);
+        check(handler.addData("a", "1") && handler.addData("b", "2"), "maxPendingChanges: add");
+        check(handler.flushStats().flushes == 0 && valueInFile(filename, "a").empty(), "maxPendingChanges: flushed early");
+        check(handler.addData("c", "3"), "maxPendingChanges: add");
+        check(handler.flushStats().flushes == 1 && handler.flushStats().changesFlushed == 3,
+              "maxPendingChanges: not flushed at the limit");
+        check(valueInFile(filename, "a") == "1" && valueInFile(filename, "c") == "3", "maxPendingChanges: file");
+    }
+
+    options.flushPolicy = noLimits();
+    options.flushPolicy.maxDirtyBytes = 100;
+    {
+        JXSL handler(filename, options);
+        check(handler.addData("small", "0123456789"), "maxDirtyBytes: add");
+        check(handler.flushStats().flushes == 0, "maxDirtyBytes: flushed early");
+        check(handler.addData("large", std::string(100, 'x')), "maxDirtyBytes: add");
+        check(handler.flushStats().flushes == 1 && handler.flushStats().bytesChanged >= 100,
+              "maxDirtyBytes: not flushed at the limit");
+        check(valueInFile(filename, "large") == std::string(100, 'x'), "maxDirtyBytes: file");
+    }
+
+    // without the flusher the age is checked when the next change is made
+    options.flushPolicy = noLimits();
+    options.flushPolicy.maxAge = std::chrono::milliseconds(50);
+    {
+        JXSL handler(filename, options);
+        check(handler.addData("old", "1"), "maxAge: add");
+        check(handler.flushStats().flushes == 0, "maxAge: flushed early");
+        std::this_thread::sleep_for(std::chrono::milliseconds(60));
+        check(handler.addData("young", "2"), "maxAge: add");
+        check(handler.flushStats().flushes == 1 && valueInFile(filename, "old") == "1", "maxAge: not flushed when due");
+    }
+
+    // manualOnly overrides every limit; lowering a limit below what is pending flushes at once
+    options.flushPolicy.maxPendingChanges = 1;
+    options.flushPolicy.manualOnly = true;
+    options.flushPolicy.flushOnDestruction = false;
+    {
+        JXSL handler(filename, options);
+        check(handler.addData("manual", "1") && handler.addData("manual2", "2"), "manualOnly: add");
+        check(handler.flushStats().flushes == 0, "manualOnly: flushed by a limit");
+        handler.flushToFile();
+        check(handler.flushStats().flushes == 1 && valueInFile(filename, "manual2") == "2", "manualOnly: flushToFile");
+
+        check(handler.addData("lowered", "1"), "setFlushPolicy: add");
+        FlushPolicy lowered = noLimits();
+        lowered.maxPendingChanges = 1;
+        lowered.flushOnDestruction = false;
+        handler.setFlushPolicy(lowered);
+        check(handler.flushStats().flushes == 2 && valueInFile(filename, "lowered") == "1",
+              "setFlushPolicy: not flushed at the new limit");
+
+        handler.setFlushPolicy(options.flushPolicy);
+        check(handler.addData("lost", "1"), "flushOnDestruction: add");
+    }
+    check(valueInFile(filename, "lost").empty(), "flushOnDestruction: flushed anyway");
+    {
+        JXSL handler(filename, {}); // the default policy flushes on destruction
+        check(handler.addData("kept", "1"), "flushOnDestruction: add");
+    }
+    check(valueInFile(filename, "kept") == "1", "flushOnDestruction: change lost");
+    std::remove(filename.c_str());
+}
+
+// with backgroundFlush the flusher thread writes: changes return at once, and an idle handler is flushed by age
+void testBackgroundFlush(const std::string& filename) {
+    writeText(filename, "{}");
+    JxslOptions options;
+    options.backgroundFlush = true;
+    options.flushPolicy = noLimits();
+    options.flushPolicy.maxAge = std::chrono::milliseconds(20);
+    {
+        JXSL handler(filename, options);
+        check(handler.addData("aged", "1"), "background: add");
+        check(waitForFlushed(handler, 1) && valueInFile(filename, "aged") == "1", "background: not flushed by age");
+    }
+
+    options.flushPolicy = noLimits();
+    options.flushPolicy.maxPendingChanges = 100;
+    options.flushPolicy.flushOnDestruction = false;
+    {
+        JXSL handler(filename, options);
+        std::vector<std::thread> writers;
+        for (int t = 0; t < 4; t++) {
+            writers.emplace_back([&handler, t] {
+                for (int i = 0; i < 100; i++) {
+                    const std::string key = "t" + std::to_string(t) + "k" + std::to_string(i);
+                    check(handler.addData(key, std::to_string(i)), "background: concurrent add of " + key);
+                }
+            });
+        }
+        for (std::thread& writer : writers) writer.join();
+        // changes made during a flush go into the next one: whatever the flushes were, fewer than 100 are left
+        check(waitForFlushed(handler, 301), "background: 400 changes with a limit of 100 not flushed");
+
+        // sync() is a barrier: the rest, which no limit flushes, is in the file when it returns
+        handler.sync();
+        check(handler.flushStats().changesFlushed == 400, "sync: not everything flushed");
+    }
+    for (int t = 0; t < 4; t++) {
+        for (int i = 0; i < 100; i += 9) {
+            const std::string key = "t" + std::to_string(t) + "k" + std::to_string(i);
+            check(valueInFile(filename, key) == std::to_string(i), "background: " + key + " not in the file");
+        }
+    }
+
+    options.flushPolicy = noLimits(); // the flusher never writes by itself
+    options.flushPolicy.flushOnDestruction = false;
+    {
+        JXSL handler(filename, options);
+        check(handler.addData("last", "1"), "sync: add");
+        handler.sync();
+        check(handler.flushStats().flushes == 1 && valueInFile(filename, "last") == "1", "sync: not flushed");
+        handler.sync(); // nothing pending: no flush, only the file is synced
+        check(handler.flushStats().flushes == 1, "sync: flushed without changes");
+    }
+    std::remove(filename.c_str());
+}
+
+#ifdef JXSL_POSIX_IO
+// a rewrite goes to <file>.tmp, which replaces the file in one rename: the old inode is left as it was, so a reader
+// that has it open sees the old document complete, and a write that fails leaves the old file in place
+void testAtomicRewrite(const std::string& filename) {
+    const std::string original = "{\"first\": \"1\", \"second\": \"2\"}";
+    writeText(filename, original);
+    chmod(filename.c_str(), 0640);
+    struct stat before {};
+    stat(filename.c_str(), &before);
+    const int reader = ::open(filename.c_str(), O_RDONLY);
+    check(reader >= 0, "rewrite: open");
+
+    JxslOptions options;
+    options.flushPolicy.flushOnDestruction = false;
+    {
+        JXSL handler(filename, options);
+        check(handler.deleteData("first"), "rewrite: delete"); // the first JSON member: the file is rewritten
+        check(handler.addData("third", "3"), "rewrite: add");
+        handler.flushToFile();
+        check(handler.flushStats().rewrites == 1, "rewrite: the file was patched instead");
+    }
+    struct stat after {};
+    stat(filename.c_str(), &after);
+    check(after.st_ino != before.st_ino, "rewrite: the file was written in place");
+    check((after.st_mode & 07777) == 0640, "rewrite: permissions not kept");
+    check(access((filename + ".tmp").c_str(), F_OK) != 0, "rewrite: temporary file left behind");
+    check(valueInFile(filename, "third") == "3" && valueInFile(filename, "first").empty(), "rewrite: changes lost");
+    std::string old(original.size() + 1, '\0');
+    check(reader >= 0 && pread(reader, old.data(), old.size(), 0) == static_cast<ssize_t>(original.size()) &&
+              old.compare(0, original.size(), original) == 0,
+          "rewrite: the old file changed under an open reader");
+    if (reader >= 0) ::close(reader);
+
+    // the write stops at the file size limit, part way into the temporary file
+    writeText(filename, original);
+    {
+        JXSL handler(filename, options);
+        check(handler.deleteData("first") && handler.addData("large", std::string(8192, 'x')), "failed write: change");
+        std::signal(SIGXFSZ, SIG_IGN); // the write fails with EFBIG instead of ending the process
+        rlimit limit {};
+        getrlimit(RLIMIT_FSIZE, &limit);
+        const rlimit lowered{4096, limit.rlim_max};
+        setrlimit(RLIMIT_FSIZE, &lowered);
+        handler.flushToFile();
+        setrlimit(RLIMIT_FSIZE, &limit);
+        std::signal(SIGXFSZ, SIG_DFL);
+        check(handler.flushStats().failedFlushes == 1 && handler.flushStats().flushes == 0,
+              "failed write: flush not reported as failed");
+        check(readText(filename) == original, "failed write: the original file was changed");
+        check(access((filename + ".tmp").c_str(), F_OK) != 0, "failed write: temporary file left behind");
+
+        // the temporary file cannot be created at all
+        check(mkdir((filename + ".tmp").c_str(), 0755) == 0, "failed write: mkdir");
+        handler.flushToFile();
+        rmdir((filename + ".tmp").c_str());
+        check(handler.flushStats().failedFlushes == 2 && readText(filename) == original,
+              "failed write: the original file was changed by a flush that could not start");
+
+        handler.flushToFile(); // the changes are still pending
+        check(handler.flushStats().flushes == 1, "failed write: retry failed");
+    }
+    check(valueInFile(filename, "large") == std::string(8192, 'x') && valueInFile(filename, "first").empty(),
+          "failed write: changes lost by the retry");
+    std::remove(filename.c_str());
+}
+#endif
+
+} // namespace
+
+int main() {
+    testMemoryResource("options_resource.json", LoadMode::Eager, "JSON eager");
+    testMemoryResource("options_resource.json", LoadMode::Lazy, "JSON lazy");
+    testMemoryResource("options_resource.xml", LoadMode::Eager, "XML eager");
+    testMemoryResource("options_resource.xml", LoadMode::Lazy, "XML lazy");
+    testFlushPolicy("options_policy.json");
+    testBackgroundFlush("options_background.json");
+#ifdef JXSL_POSIX_IO
+    testAtomicRewrite("options_rewrite.json");
+#endif
+
+    if (failures) {
+        std::cerr << failures << " check(s) failed\n";
+        return 1;
+    }
+    std::cout << "All option tests passed\n";
+    return 0;
+}
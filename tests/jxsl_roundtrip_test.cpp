@@ -0,0 +1,176 @@
+// Round-trip tests: what is loaded is written back with the same types and values, whichever way the file is written
+
+#include "jxsl_lib_cpp.h"
+#include "jxsl_document.h"
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+
+int failures = 0;
+
+void check(const bool condition, const std::string& what) {
+    if (!condition) {
+        std::cerr << "[FAIL] " << what << "\n";
+        failures++;
+    }
+}
+
+std::string readText(const std::string& filename) {
+    std::ifstream file(filename, std::ios::binary);
+    std::ostringstream text;
+    text << file.rdbuf();
+    return text.str();
+}
+
+void writeText(const std::string& filename, const std::string& text) {
+    std::ofstream(filename, std::ios::binary) << text;
+}
+
+struct Member {
+    std::string key;
+    NodeType type;
+    std::string text; // string contents, literal, or raw text of an object/array
+};
+
+const std::vector<Member> SCALARS = {
+    {"n", NodeType::Number, "5"},       {"f", NodeType::Number, "-1.5e3"}, {"t", NodeType::Bool, "true"},
+    {"b", NodeType::Bool, "false"},     {"z", NodeType::Null, "null"},     {"s", NodeType::String, "text"},
+    {"q", NodeType::String, "5"},       {"o", NodeType::Object, "{\"a\": [1, 2]}"},
+    {"a", NodeType::Array, "[true, null]"},
+};
+
+std::string scalarsJson() {
+    std::string json = "{";
+    for (const Member& member : SCALARS) {
+        json += (json.size() > 1 ? ", \"" : "\"") + member.key + "\": ";
+        json += member.type == NodeType::String ? "\"" + member.text + "\"" : member.text;
+    }
+    return json + "}";
+}
+
+// every member of SCALARS that is not in 'gone' is in the text with its type and value
+void checkMembers(const std::string& text, const std::vector<std::string>& gone, const std::string& what) {
+    Document document;
+    if (!document.parseJson(text)) {
+        check(false, what + ": not well-formed:\n" + text);
+        return;
+    }
+    for (const Member& member : SCALARS) {
+        const DocumentNode* node = document.root()->find(member.key);
+        if (std::find(gone.begin(), gone.end(), member.key) != gone.end()) {
+            check(!node, what + ": deleted member " + member.key + " is back");
+            continue;
+        }
+        check(node && node->type == member.type && node->text == member.text,
+              what + ": member " + member.key + " changed:\n" + text);
+    }
+}
+
+void testScalarsKeepTheirType(const LoadMode mode, const std::string& name) {
+    const std::string filename = "roundtrip_scalars.json";
+    writeText(filename, scalarsJson());
+    JxslOptions options;
+    options.loadMode = mode;
+
+    {
+        JXSL handler(filename, options);
+        std::string serialized(handler.serializedSize(), '\0');
+        check(handler.serializeTo(serialized) == serialized.size(), name + ": serializedSize() does not fit");
+        checkMembers(serialized, {}, name + " serialized");
+        check(handler.addData("added", "x"), name + ": add");
+    }
+    checkMembers(readText(filename), {}, name + " after an in-place flush");
+
+    {
+        JXSL handler(filename, options);
+        check(handler.deleteData("n"), name + ": delete"); // the first member: the file is rewritten
+    }
+    checkMembers(readText(filename), {"n"}, name + " after a rewrite");
+
+    {
+        JXSL handler(filename, options);
+        std::string value;
+        check(handler.readData("t", value) && value == "true", name + ": read of a literal");
+        check(handler.editData("t", "yes"), name + ": edit"); // replaced by a string
+        check(handler.readData("t", value) && value == "yes", name + ": read after the edit");
+    }
+    Document document;
+    check(document.parseJson(readText(filename)) && document.root()->find("t") &&
+              document.root()->find("t")->type == NodeType::String,
+          name + ": an edited value is not a string:\n" + readText(filename));
+    std::remove(filename.c_str());
+}
+
+// a lazy lookup of a key far into the file materializes every member in front of it, growing the table many times:
+// whatever refers to the table from before must be looked up again
+void testLazyLookupGrowsTable() {
+    const std::string filename = "roundtrip_lazy.json";
+    constexpr int KEYS = 5000;
+    std::string json = "{";
+    for (int i = 0; i < KEYS; i++) {
+        json += (i ? ",\n    \"k" : "\n    \"k") + std::to_string(i) + "x\": \"v" + std::to_string(i) + "\"";
+    }
+    writeText(filename, json + "\n}");
+    JxslOptions options;
+    options.loadMode = LoadMode::Lazy;
+    options.flushPolicy.flushOnDestruction = false;
+
+    {
+        JXSL handler(filename, options);
+        std::string value;
+        check(handler.readData("k4000x", value) && value == "v4000", "lazy read behind a growing table");
+    }
+    {
+        JXSL handler(filename, options);
+        std::string value;
+        check(handler.editData("k4500x", "edited") && handler.readData("k4500x", value) && value == "edited",
+              "lazy edit behind a growing table");
+        check(handler.readData("k4999x", value) && value == "v4999", "lazy read after an edit");
+    }
+    std::remove(filename.c_str());
+}
+
+void testNumberGrammar() {
+    for (const char* number : {"0", "-0", "12", "-1.5", "1e9", "2.5E-3", "1E+2"}) {
+        Document document;
+        check(document.parseJson(std::string("{\"a\": ") + number + "}") &&
+                  document.root()->firstChild->type == NodeType::Number,
+              std::string("valid number rejected: ") + number);
+    }
+    for (const char* literal : {"-", "--1", "1-2", "01", "1.", ".5", "1e", "1e+", "+1", "0x10", "1.2.3", "nul"}) {
+        Document document;
+        check(!document.parseJson(std::string("{\"a\": ") + literal + "}"), std::string("invalid number accepted: ") + literal);
+    }
+}
+
+void testDataBehindRoot() {
+    for (const char* trailing : {"{\"a\":\"b\"} garbage", "{\"a\":\"b\"}}", "{\"a\":\"b\"}{}", "{\"a\":\"b\"},", "[1] 2"}) {
+        Document document;
+        check(!document.parseJson(trailing), std::string("data behind the root accepted: ") + trailing);
+    }
+    Document document;
+    check(document.parseJson("\r\n {\"a\":\"b\"} \r\n\t"), "whitespace around the root rejected");
+}
+
+} // namespace
+
+int main() {
+    testScalarsKeepTheirType(LoadMode::Eager, "eager");
+    testScalarsKeepTheirType(LoadMode::Lazy, "lazy");
+    testLazyLookupGrowsTable();
+    testNumberGrammar();
+    testDataBehindRoot();
+
+    if (failures) {
+        std::cerr << failures << " check(s) failed\n";
+        return 1;
+    }
+    std::cout << "All round-trip tests passed\n";
+    return 0;
+}
@@ -0,0 +1,178 @@
+// Streaming parser tests: a document fed in pieces gives the same events wherever the pieces are cut
+
+#include "jxsl_json_stream.h"
+#include "jxsl_xml_stream.h"
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+
+int failures = 0;
+
+void check(const bool condition, const std::string& what) {
+    if (!condition) {
+        std::cerr << "[FAIL] " << what << "\n";
+        failures++;
+    }
+}
+
+// records every event as one line
+class JsonRecorder : public JsonHandler {
+public:
+    std::string events;
+    void onStartObject() override { events += "{\n"; }
+    void onEndObject() override { events += "}\n"; }
+    void onStartArray() override { events += "[\n"; }
+    void onEndArray() override { events += "]\n"; }
+    void onKey(const std::string_view key) override { events += "key " + std::string(key) + "\n"; }
+    void onString(const std::string_view value) override { events += "string " + std::string(value) + "\n"; }
+    void onNumber(const std::string_view literal) override { events += "number " + std::string(literal) + "\n"; }
+    void onBool(const bool value) override { events += value ? "true\n" : "false\n"; }
+    void onNull() override { events += "null\n"; }
+};
+
+// events of the document fed in pieces cut at the given offsets; "error" if the parser rejects it
+std::string parseJson(const std::string& document, const std::vector<size_t>& cuts) {
+    JsonRecorder recorder;
+    JsonStreamParser parser(recorder);
+    size_t from = 0;
+    bool parsed = true;
+    for (const size_t cut : cuts) {
+        parsed = parsed && parser.feed(document.data() + from, cut - from);
+        from = cut;
+    }
+    parsed = parsed && parser.feed(document.data() + from, document.size() - from) && parser.finish();
+    return parsed ? recorder.events : "error";
+}
+
+void testJsonSplitAnywhere() {
+    // strings with escapes (one ending in an escaped backslash), literals of every kind, nesting, empty containers
+    const std::string document = "{\"plain\": \"value\", \"esc\\\"aped\": \"a \\\"quoted\\\" \\\\ \\u00e9 text\\\\\", "
+                                 "\"numbers\": [0, -12, 3.25, -1.5e+3, 2E-7], \"flags\": [true, false, null], "
+                                 "\"nested\": {\"empty\": {}, \"none\": [], \"s\": \"\"}}";
+    const std::string expected =
+        "{\nkey plain\nstring value\nkey esc\\\"aped\nstring a \\\"quoted\\\" \\\\ \\u00e9 text\\\\\n"
+        "key numbers\n[\nnumber 0\nnumber -12\nnumber 3.25\nnumber -1.5e+3\nnumber 2E-7\n]\n"
+        "key flags\n[\ntrue\nfalse\nnull\n]\n"
+        "key nested\n{\nkey empty\n{\n}\nkey none\n[\n]\nkey s\nstring \n}\n}\n";
+    check(parseJson(document, {}) == expected, "JSON in one piece:\n" + parseJson(document, {}));
+
+    for (size_t cut = 0; cut <= document.size(); cut++) {
+        check(parseJson(document, {cut}) == expected, "JSON cut at byte " + std::to_string(cut));
+    }
+    for (size_t first = 0; first <= document.size(); first++) { // two cuts: tokens spanning three pieces
+        for (size_t second = first; second <= document.size(); second += 7) {
+            check(parseJson(document, {first, second}) == expected,
+                  "JSON cut at bytes " + std::to_string(first) + " and " + std::to_string(second));
+        }
+    }
+    std::vector<size_t> everyByte;
+    for (size_t cut = 1; cut < document.size(); cut++) everyByte.push_back(cut);
+    check(parseJson(document, everyByte) == expected, "JSON fed one byte at a time");
+
+    // a literal at the very end of the input ends only with finish()
+    check(parseJson("12", {1}) == "number 12\n", "top-level number cut in the middle");
+}
+
+void testJsonNumberGrammar() {
+    for (const std::string number : {"0", "-0", "12", "-1.5", "1e9", "2.5E-3", "1E+2"}) {
+        const std::string document = "[" + number + "]";
+        for (size_t cut = 0; cut <= document.size(); cut++) {
+            check(parseJson(document, {cut}) == "[\nnumber " + number + "\n]\n", "valid number rejected: " + number);
+        }
+    }
+    for (const std::string literal : {"-", "--1", "1-2", "01", "1.", ".5", "1e", "1e+", "+1", "0x10", "1.2.3", "nul"}) {
+        const std::string document = "{\"a\": " + literal + "}";
+        for (size_t cut = 0; cut <= document.size(); cut++) {
+            check(parseJson(document, {cut}) == "error", "invalid literal accepted: " + literal);
+        }
+    }
+}
+
+void testJsonMalformed() {
+    for (const std::string document : {"{\"a\": \"open", "{\"a\" 1}", "{\"a\": 1,}", "[1 2]", "{\"a\": 1}}", "{\"a\": tru}"}) {
+        for (size_t cut = 0; cut <= document.size(); cut++) {
+            check(parseJson(document, {cut}) == "error", "malformed JSON accepted: " + document);
+        }
+    }
+}
+
+// events of the document read through a buffer of the given size, adjacent text pieces joined; ends with "error"
+// if the reader rejects it
+std::string readXml(const std::string& document, const size_t bufferSize) {
+    std::istringstream input(document);
+    XmlPullReader reader(input, bufferSize);
+    std::string events;
+    std::string text;
+    while (true) {
+        const XmlEvent event = reader.next();
+        if (event == XmlEvent::Text) {
+            text.append(reader.text());
+            continue;
+        }
+        if (!text.empty()) events += "text " + text + "\n";
+        text.clear();
+        switch (event) {
+            case XmlEvent::StartElement: events += "<" + std::string(reader.name()) + "\n"; break;
+            case XmlEvent::EndElement: events += "/" + std::string(reader.name()) + "\n"; break;
+            case XmlEvent::EndDocument: return events;
+            default: return events + "error";
+        }
+    }
+}
+
+void testXmlSplitAnywhere() {
+    // comments, CDATA (one holding "]]" and "-->"), entities, self-closing tags and attributes, nesting
+    const std::string document = "<?xml version=\"1.0\"?>\n<!-- leading -- comment -->\n<root><item id=\"1\">a &amp; b</item>"
+                                 "<!-- inner <tag> --><data><![CDATA[x]]y <z> -->]]></data><empty/><e attr=\"v\" />"
+                                 "<deep><deeper>t<![CDATA[]]></deeper></deep></root>\n";
+    const std::string expected = "<root\n<item\ntext a &amp; b\n/item\n<data\ntext x]]y <z> -->\n/data\n<empty\n/empty\n"
+                                 "<e\n/e\n<deep\n<deeper\ntext t\n/deeper\n/deep\n/root\n";
+    check(readXml(document, 64 * 1024) == expected, "XML in one piece:\n" + readXml(document, 64 * 1024));
+
+    // the buffer is refilled from the token that ran out of data, so every buffer size up to the whole document puts
+    // the refill boundary at a different byte of every later token
+    for (size_t bufferSize = 16; bufferSize <= document.size(); bufferSize++) {
+        check(readXml(document, bufferSize) == expected, "XML read through a " + std::to_string(bufferSize) + " byte buffer");
+    }
+
+    // a CDATA section and text larger than the buffer arrive in pieces; the closing "]]>" may be cut anywhere
+    for (size_t bufferSize = 12; bufferSize <= 20; bufferSize++) {
+        for (size_t length = 0; length < bufferSize; length++) {
+            std::string large(length, 'x');
+            while (large.size() < 100 + length) large += "]x";
+            check(readXml("<a><![CDATA[" + large + "]]>" + large + "</a>", bufferSize) == "<a\ntext " + large + large + "\n/a\n",
+                  "large CDATA of " + std::to_string(large.size()) + " bytes through a " + std::to_string(bufferSize) +
+                      " byte buffer");
+        }
+    }
+}
+
+void testXmlMalformed() {
+    for (const std::string document : {"<a>text", "<a><!-- open </a>", "<a><![CDATA[open</a>", "<a></b>", "<a", "text<a/>"}) {
+        for (size_t bufferSize = 16; bufferSize <= 32; bufferSize++) {
+            const std::string events = readXml(document, bufferSize);
+            check(events.size() >= 5 && events.compare(events.size() - 5, 5, "error") == 0,
+                  "malformed XML accepted: " + document);
+        }
+    }
+}
+
+} // namespace
+
+int main() {
+    testJsonSplitAnywhere();
+    testJsonNumberGrammar();
+    testJsonMalformed();
+    testXmlSplitAnywhere();
+    testXmlMalformed();
+
+    if (failures) {
+        std::cerr << failures << " check(s) failed\n";
+        return 1;
+    }
+    std::cout << "All streaming parser tests passed\n";
+    return 0;
+}
@@ -0,0 +1,149 @@
+// Write-ahead log tests: checkpoints, group commit and replay after a crash
+
+#include "jxsl_lib_cpp.h"
+#include "jxsl_wal.h"
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define JXSL_POSIX_IO 1
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+int failures = 0;
+
+void check(const bool condition, const std::string& what) {
+    if (!condition) {
+        std::cerr << "[FAIL] " << what << "\n";
+        failures++;
+    }
+}
+
+// keys of the records in the log, in order (deletes marked with a leading '-')
+std::vector<std::string> replayed(const std::string& path) {
+    std::vector<std::string> keys;
+    WriteAheadLog log;
+    check(log.open(path), path + ": reopen");
+    log.replay([&](const WalOp op, const std::string_view key, std::string_view) {
+        keys.push_back((op == WalOp::Delete ? "-" : "") + std::string(key));
+    });
+    return keys;
+}
+
+// a flush takes the checkpoint offset, writes the document unlocked and then discards the log up to the offset:
+// changes appended meanwhile are not in the document and must stay in the log
+void testCheckpointKeepsLaterChanges() {
+    const std::string path = "wal_test_checkpoint.wal";
+    std::remove(path.c_str());
+    {
+        WriteAheadLog log;
+        check(log.open(path), path + ": open");
+        check(log.append(WalOp::Put, "a", "1") && log.commit(), path + ": append a");
+        const uint64_t checkpoint = log.size();
+        check(log.append(WalOp::Put, "b", "2"), path + ": append b"); // batched, not committed yet
+        check(log.discardUpTo(checkpoint), path + ": discard everything committed");
+    }
+    check(replayed(path) == std::vector<std::string>{"b"}, path + ": a change batched during a full checkpoint was lost");
+
+    {
+        WriteAheadLog log;
+        check(log.open(path), path + ": open");
+        const uint64_t checkpoint = log.size();
+        check(log.append(WalOp::Delete, "c") && log.commit(), path + ": append c");
+        check(log.append(WalOp::Put, "d", "4"), path + ": append d");
+        check(log.discardUpTo(checkpoint), path + ": discard a prefix");
+    }
+    check(replayed(path) == std::vector<std::string>{"-c", "d"}, path + ": a change batched during a checkpoint was lost");
+    std::remove(path.c_str());
+}
+
+// threads committing at the same time share syncs, but each one returns only once its own records are durable
+void testConcurrentCommits() {
+    const std::string path = "wal_test_concurrent.wal";
+    std::remove(path.c_str());
+    constexpr int THREADS = 8;
+    constexpr int RECORDS = 50;
+    {
+        WriteAheadLog log;
+        check(log.open(path), path + ": open");
+        std::vector<std::thread> threads;
+        std::vector<int> failed(THREADS, 0);
+        for (int t = 0; t < THREADS; t++) {
+            threads.emplace_back([&, t] {
+                for (int i = 0; i < RECORDS; i++) {
+                    const std::string key = std::to_string(t) + "." + std::to_string(i);
+                    if (!log.append(WalOp::Put, key, "v") || !log.commit()) failed[t]++;
+                }
+            });
+        }
+        for (std::thread& thread : threads) thread.join();
+        check(std::count(failed.begin(), failed.end(), 0) == THREADS, path + ": failed commits");
+    }
+    std::vector<std::string> keys = replayed(path);
+    std::sort(keys.begin(), keys.end());
+    check(keys.size() == THREADS * RECORDS && std::adjacent_find(keys.begin(), keys.end()) == keys.end(),
+          path + ": records lost or duplicated");
+    std::remove(path.c_str());
+}
+
+#ifdef JXSL_POSIX_IO
+// a change is acknowledged only once it is in the log: a process that dies right after the call returned loses nothing
+void testChangesSurviveCrash() {
+    const std::string filename = "wal_test_crash.json";
+    std::remove(filename.c_str());
+    std::remove((filename + ".wal").c_str());
+    std::ofstream(filename) << "{}";
+
+    JxslOptions options;
+    options.writeAheadLog = true;
+    options.flushPolicy.manualOnly = true; // nothing reaches the document: only the log can bring the changes back
+    constexpr int CHANGES = 5;
+    const pid_t child = fork();
+    if (child == 0) {
+        JXSL handler(filename, options);
+        bool acknowledged = true;
+        for (int i = 0; i < CHANGES; i++) acknowledged = handler.addData("k" + std::to_string(i) + "x", "v") && acknowledged;
+        acknowledged = handler.editData("k0x", "edited") && handler.deleteData("k1x") && acknowledged;
+        _exit(acknowledged ? 0 : 1); // no destructors, no flush: as if the process crashed here
+    }
+    int status = 0;
+    check(child > 0 && waitpid(child, &status, 0) == child && WIFEXITED(status) && WEXITSTATUS(status) == 0,
+          filename + ": changes not acknowledged");
+
+    options.flushPolicy.flushOnDestruction = false;
+    JXSL handler(filename, options);
+    std::string value;
+    check(handler.readData("k0x", value) && value == "edited", filename + ": edit lost in the crash");
+    check(!handler.readData("k1x", value), filename + ": delete lost in the crash");
+    for (int i = 2; i < CHANGES; i++) {
+        check(handler.readData("k" + std::to_string(i) + "x", value), filename + ": add lost in the crash");
+    }
+    std::remove(filename.c_str());
+    std::remove((filename + ".wal").c_str());
+}
+#endif
+
+} // namespace
+
+int main() {
+    testCheckpointKeepsLaterChanges();
+    testConcurrentCommits();
+#ifdef JXSL_POSIX_IO
+    testChangesSurviveCrash();
+#endif
+
+    if (failures) {
+        std::cerr << failures << " check(s) failed\n";
+        return 1;
+    }
+    std::cout << "All write-ahead log tests passed\n";
+    return 0;
+}